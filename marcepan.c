@@ -12,11 +12,33 @@
  * 
  *   1. CALCULATION: Worker threads compute raw iteration counts into a buffer.
  *      This is the expensive part - complex number math for each pixel.
+ *      The inner loop runs 4 or 8 pixels at once with AVX2/AVX-512/NEON,
+ *      chosen at startup by CPU feature detection (scalar fallback).
+ *      Shallow views run in float with twice the lanes, and Julia views
+ *      too deep for doubles in long double (--precision).
+ *      Rows mirroring others across the real axis (the origin for Julia
+ *      sets) are copied instead of computed.
+ *      The pool is sized to the CPUs the affinity mask and cgroup quota
+ *      allow; --affinity pins workers, optionally spread over NUMA nodes.
+ *      Frames are computed in the background; keys keep being read, and a
+ *      view change cancels a frame that has become stale. All keys that
+ *      have arrived are applied before the next frame starts. A terminal
+ *      resize (SIGWINCH) keeps the pixel spacing, so only the new margins
+ *      are computed.
+ *      Past the resolution of doubles, Mandelbrot views switch to
+ *      perturbation against a fixed-point reference orbit (deep zoom).
+ *      With --backend gpu, plain double-precision frames run as an OpenCL
+ *      kernel instead (loaded at run time, CPU fallback). With
+ *      --coordinator, tiles go to other marcepan processes running --serve,
+ *      which compute them with the same kernels.
  * 
  *   2. PRESENTATION: Map iteration values to ASCII chars and colors.
  *      This is cheap - just array lookups. Allows instant palette switching!
  * 
- *   3. EXPORT: Save current view to file using the same mapping logic.
+ *   3. EXPORT: Save current view to file using the same mapping logic,
+ *      formatted in parallel and written by a background thread.
+ *      --daemon keeps one process, its pool and caches, serving render
+ *      requests from stdin or a Unix socket.
  * 
  * COMPILATION
  * -----------
@@ -32,28 +54,53 @@
  *   Color palette:  1 and 2 keys
  *   Toggles:        c = color, m = modulo/linear, j = Julia/Mandelbrot
  *                   h = half-block mode (2x vertical resolution)
- *   Save:           p = plain .txt, P = colored .ansi
+ *                   s = frame cost overlay on the header
+ *   Save:           p = plain .txt, P = colored .ansi, r = raw counts (--load),
+ *                   i = .png image
  *   Other:          ESC = reset, q = quit
  * 
- * The header shows a copy-pasteable command to recreate the current view.
+ * The header shows a copy-pasteable command to recreate the current view,
+ * and with s what the frame cost to compute and draw.
  * 
  */
 
+#define _GNU_SOURCE               /* sched_getaffinity, pthread_attr_setaffinity_np */
 #define _POSIX_C_SOURCE 200809L
 
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <poll.h>
+#include <dlfcn.h>
 #include <termios.h>
 #include <sys/select.h>
 #include <time.h>
 #include <pthread.h>
+#include <sched.h>
 #include <errno.h>
 #include <stdint.h>
 #include <signal.h>
 #include <math.h>
+#include <float.h>
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 /* ========================================================================== */
 /*                              CONSTANTS                                     */
@@ -67,6 +114,19 @@
 #define MAX_CUSTOM_PAL   256
 #define OUTBUF_PER_CELL  32       /* Increased for half-block ANSI codes */
 #define MAX_STATUS_LEN   128
+#define TILE_W           32       /* Scheduling unit for dynamic/steal modes */
+#define TILE_H           8
+#define MS_TILE_W        64       /* Larger tiles for Mariani-Silver, which */
+#define MS_TILE_H        32       /* saves more the bigger its rectangles are */
+#define MS_MIN_SIZE      6        /* Compute rectangles this small directly */
+#define PROGRESSIVE_STRIDE 8      /* First progressive pass: 1/8 resolution */
+#define CACHE_TILE_W     8        /* Tile cache granularity, in grid pixels */
+#define CACHE_TILE_H     4
+#define BIG_LIMBS        20       /* 32-bit limbs of deep-zoom fixed point (1 integer) */
+#define MAX_CMDLINE      1024     /* Deep-zoom coordinates can be long */
+#define MAX_POSTER_SIZE  1000000  /* Per side of an offline render (-W/-H) */
+#define POSTER_BAND_CELLS (1 << 20)   /* Cells per band of an offline render */
+#define MAX_FRAMES       1000000  /* Length of a zoom animation */
 
 /* Virtual key codes for special keys */
 enum {
@@ -77,6 +137,10 @@ enum {
     KEY_ESC, KEY_ENTER, KEY_SLASH, KEY_STAR, KEY_PLUS, KEY_MINUS
 };
 
+/* Iteration count of one pixel */
+typedef uint16_t IterCount;
+_Static_assert(MAX_ITERATIONS <= UINT16_MAX, "MAX_ITERATIONS must fit in IterCount");
+
 /* ========================================================================== */
 /*                            GLOBAL STATE                                    */
 /* ========================================================================== */
@@ -85,12 +149,28 @@ enum {
 static struct termios orig_tio;
 static int term_w = 80, term_h = 24;
 static int batch_mode = 0;
+static int poster_w = 0, poster_h = 0;   /* Offline render size (-W/-H), 0 = terminal */
+static const char *output_path = NULL;  /* Offline render file (-o), NULL = stdout */
 
 /* Viewport in complex plane */
 static double view_xmin = -2.0, view_xmax = 1.0;
 static double view_ymin = -1.0, view_ymax = 1.0;
+
+/* Signed fixed point, magnitude least significant limb first */
+typedef struct {
+    uint32_t limb[BIG_LIMBS];
+    int neg;
+} BigFix;
+
+/* Deep zoom: the viewport above is relative to this origin (see update_view_origin) */
+static BigFix view_origin_re, view_origin_im;
 static int max_iter = 30;
 
+/* Zoom animation (--frames, --zoom-to): frame count, target center and width */
+static int anim_frames = 0;
+static BigFix anim_re, anim_im;
+static double anim_width;
+
 /* Julia mode: when enabled, julia_cr/ci define the constant c */
 static int julia_mode = 0;
 static double julia_cr = -0.7, julia_ci = 0.27015;  /* Classic Julia point */
@@ -103,6 +183,13 @@ static const double ZOOM_FRACTION = 0.3;
 static int use_color = 1;
 static int use_modulo = 1;
 static int use_halfblock = 0;    /* Half-block rendering for 2x vertical res */
+static int interior_check = 1;   /* Cardioid/bulb + periodicity shortcuts */
+static int progressive = 0;      /* Coarse-to-fine refinement of full frames */
+static int frame_budget_ms = 0;  /* Preview frames predicted to take longer, 0 = off */
+static int solid_guess = 0;      /* Mariani-Silver rectangle subdivision */
+static int cache_mb = 64;        /* Tile cache limit, 0 = no cache */
+static int keep_orbits = 0;      /* Keep unescaped orbits to resume on deeper max_iter */
+static int true_color = 0;       /* Images in gradient colours, not the 256-colour ones */
 static const char FILL_CHAR = ' ';
 
 /* Status message (shown instead of command line until next redraw) */
@@ -115,6 +202,22 @@ static int has_custom_palette = 0;
 /* Threading */
 static int num_threads = 0;
 
+/* Pinning of pool threads to CPUs (see plan_affinity) */
+typedef enum { AFFINITY_NONE, AFFINITY_COMPACT, AFFINITY_SPREAD } AffinityMode;
+static const char *const affinity_names[] = { "none", "compact", "spread" };
+static AffinityMode affinity_mode = AFFINITY_NONE;
+static const char *kernel_name = NULL;   /* NULL = auto-detect */
+
+/* How rows are distributed over the pool (see compute_job) */
+typedef enum { SCHED_STATIC, SCHED_DYNAMIC, SCHED_STEAL } SchedMode;
+static const char *const sched_names[] = { "static", "dynamic", "steal" };
+static SchedMode sched_mode = SCHED_DYNAMIC;
+
+/* Arithmetic of views that do not use perturbation (see view_precision) */
+typedef enum { PREC_AUTO = -1, PREC_FLOAT, PREC_DOUBLE, PREC_LONG } Precision;
+static const char *const precision_names[] = { "float", "double", "long" };
+static Precision precision_mode = PREC_AUTO;
+
 /* ========================================================================== */
 /*                           ASCII PALETTES                                   */
 /* ========================================================================== */
@@ -186,13 +289,50 @@ static void disable_raw_mode(void) {
     tcsetattr(STDIN_FILENO, TCSANOW, &orig_tio);
 }
 
-static void safe_write(int fd, const void *buf, size_t len) {
+/* Read exactly len bytes; -1 on error, timeout or end of file */
+static int safe_read(int fd, void *buf, size_t len) {
+    uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n <= 0) { if (n < 0 && errno == EINTR) continue; return -1; }
+        p += n; len -= n;
+    }
+    return 0;
+}
+
+static int safe_write(int fd, const void *buf, size_t len) {
     const uint8_t *p = buf;
     while (len > 0) {
         ssize_t n = write(fd, p, len);
-        if (n <= 0) { if (n < 0 && errno == EINTR) continue; return; }
+        if (n <= 0) { if (n < 0 && errno == EINTR) continue; return -1; }
         p += n; len -= n;
     }
+    return 0;
+}
+
+
+/* Write the buffers in order, resuming after partial writes (iov is modified) */
+static int safe_writev(int fd, struct iovec *iov, int cnt) {
+    while (cnt > 0) {
+        ssize_t n = writev(fd, iov, cnt);
+        if (n <= 0) { if (n < 0 && errno == EINTR) continue; return -1; }
+        while (cnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++; cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+    return 0;
+}
+
+/* Monotonic clock, in milliseconds */
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
 }
 
 static void cursor_hide(void) { safe_write(STDOUT_FILENO, "\x1b[?25l", 6); }
@@ -231,442 +371,5818 @@ static inline uint8_t iteration_to_color(int n, int max_n, const uint8_t *colors
 }
 
 /* ========================================================================== */
-/*                       FRACTAL CALCULATION                                  */
+/*                            THREAD POOL                                     */
 /* ========================================================================== */
 
-typedef struct {
-    int row_start, row_end;
-    int width, height;
-    int max_iter;
-    double xmin, xmax, ymin, ymax;
-    int julia_mode;
-    double julia_cr, julia_ci;
-    int *output;
-} WorkerTask;
-
 /*
- * Worker thread - calculates either Mandelbrot or Julia set.
- * 
- * Mandelbrot: z₀ = 0, c = pixel position, iterate z = z² + c
- * Julia:     z₀ = pixel position, c = fixed constant, iterate z = z² + c
+ * Long-lived worker threads, started once in main(). A job is a function
+ * that every worker runs once with its own id; pool_run() publishes the job,
+ * wakes the workers via job_cv and blocks until the last one reports back
+ * on done_cv. The generation counter lets a worker tell a new job from a
+ * spurious wakeup.
+ *
+ * pool_submit() starts a job without waiting. When it finishes, the last
+ * worker writes one byte to pool_notify_fd so the input loop can select()
+ * on it; pool_wait() then collects the job.
  */
-static void *calculate_rows(void *arg) {
-    WorkerTask *task = arg;
-    
-    double dx = (task->xmax - task->xmin) / task->width;
-    double dy = (task->ymax - task->ymin) / task->height;
+typedef void (*PoolJobFn)(void *ctx, int worker_id);
+
+typedef struct {
+    pthread_t threads[MAX_THREADS];
+    int count;                    /* Threads actually running */
+    pthread_mutex_t lock;
+    pthread_cond_t job_cv;
+    pthread_cond_t done_cv;
+    PoolJobFn job_fn;
+    void *job_ctx;
+    unsigned long generation;
+    int pending;                  /* Workers still busy with this job */
+    int notify;                   /* Signal pool_notify_fd when done */
+    int shutdown;
+} ThreadPool;
+
+static ThreadPool pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .job_cv = PTHREAD_COND_INITIALIZER,
+    .done_cv = PTHREAD_COND_INITIALIZER,
+};
+
+typedef struct { int id; } PoolWorkerArg;
+static PoolWorkerArg pool_args[MAX_THREADS];
+
+static int pool_notify_fd = -1;
+
+static void pool_signal_done(void) {
+    if (pool.notify && pool_notify_fd >= 0) {
+        char c = 1;
+        while (write(pool_notify_fd, &c, 1) < 0 && errno == EINTR) {}
+    }
+}
+
+static void *pool_worker(void *arg) {
+    int id = ((PoolWorkerArg *)arg)->id;
+    unsigned long seen = 0;
     
-    for (int row = task->row_start; row < task->row_end; row++) {
-        int *out_row = task->output + row * task->width;
-        double py = task->ymax - row * dy;
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (!pool.shutdown && pool.generation == seen)
+            pthread_cond_wait(&pool.job_cv, &pool.lock);
+        if (pool.shutdown) break;
         
-        for (int col = 0; col < task->width; col++) {
-            double px = task->xmin + col * dx;
-            
-            double zr, zi, cr, ci;
-            
-            if (task->julia_mode) {
-                /* Julia: z starts at pixel, c is constant */
-                zr = px; zi = py;
-                cr = task->julia_cr;
-                ci = task->julia_ci;
-            } else {
-                /* Mandelbrot: z starts at 0, c is pixel */
-                zr = 0; zi = 0;
-                cr = px; ci = py;
-            }
-            
-            int iter = 0;
-            while (iter < task->max_iter) {
-                double zr2 = zr * zr;
-                double zi2 = zi * zi;
-                if (zr2 + zi2 > 4.0) break;
-                zi = 2 * zr * zi + ci;
-                zr = zr2 - zi2 + cr;
-                iter++;
-            }
-            
-            out_row[col] = iter;
+        seen = pool.generation;
+        PoolJobFn fn = pool.job_fn;
+        void *ctx = pool.job_ctx;
+        pthread_mutex_unlock(&pool.lock);
+        
+        fn(ctx, id);
+        
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.pending == 0) {
+            pthread_cond_signal(&pool.done_cv);
+            pool_signal_done();
         }
     }
+    pthread_mutex_unlock(&pool.lock);
     return NULL;
 }
 
-static void snap_viewport_to_grid(int calc_height) {
-    double px = (view_xmax - view_xmin) / term_w;
-    double py = (view_ymax - view_ymin) / calc_height;
-    
-    double snapped_xmin = floor(view_xmin / px) * px;
-    double snapped_ymin = floor(view_ymin / py) * py;
-    
-    view_xmax += snapped_xmin - view_xmin;
-    view_ymax += snapped_ymin - view_ymin;
-    view_xmin = snapped_xmin;
-    view_ymin = snapped_ymin;
+/*
+ * CPU placement. sysconf() counts every CPU of the machine, but a process
+ * in a container may run on a cpuset and under a CFS quota that allow far
+ * fewer; more threads than that only queue and get throttled. The default
+ * pool size is therefore the affinity mask's CPU count, capped by the
+ * quota of the cgroup (v2 cpu.max or v1 cfs_quota_us, on the process's
+ * group and its ancestors).
+ *
+ * --affinity pins worker i to one CPU of the mask: compact takes them in
+ * order, spread deals workers round-robin over the NUMA nodes. Pinned
+ * workers also first-touch their share of each new frame buffer
+ * (pool_first_touch), so the pages they write stay on their own node.
+ */
+#define MAX_NUMA_NODES 64
+
+static int pool_cpu[MAX_THREADS];        /* CPU worker i is pinned to, -1 = none */
+
+/* Parse a sysfs CPU list such as "0-3,8,10-11" into set */
+static void parse_cpulist(const char *s, cpu_set_t *set) {
+    CPU_ZERO(set);
+    while (*s) {
+        char *end;
+        long a = strtol(s, &end, 10), b = a;
+        if (end == s) break;
+        if (*end == '-') b = strtol(end + 1, &end, 10);
+        for (long c = a; c <= b && c < CPU_SETSIZE; c++) CPU_SET(c, set);
+        s = *end == ',' ? end + 1 : end;
+        if (*s == '\n') break;
+    }
 }
 
-typedef struct { pthread_t handle; int created; } ThreadInfo;
+/* CPUs a quota file pair allows, 0 if unlimited or unreadable */
+static double cgroup_quota(const char *dir, int v2) {
+    char path[1200];
+    long quota = 0, period = 0;
+    snprintf(path, sizeof(path), "%s/%s", dir, v2 ? "cpu.max" : "cpu.cfs_quota_us");
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    int n = v2 ? fscanf(f, "%ld %ld", &quota, &period) : fscanf(f, "%ld", &quota);
+    fclose(f);
+    if (!v2 && n == 1) {
+        snprintf(path, sizeof(path), "%s/cpu.cfs_period_us", dir);
+        f = fopen(path, "r");
+        if (!f) return 0;
+        n = 1 + fscanf(f, "%ld", &period);
+        fclose(f);
+    }
+    return n == 2 && quota > 0 && period > 0 ? (double)quota / period : 0;
+}
 
-/*
- * Compute fractal. In half-block mode, we calculate 2x the rows.
- */
-static int compute_fractal(int **out_buffer, int *out_w, int *out_h) {
-    update_term_size();
-    
-    int w = term_w;
-    int h = use_halfblock ? term_h * 2 : term_h;  /* Double rows for half-blocks */
+/* CPUs the cgroup CPU quota allows, rounded to nearest, 0 if unlimited */
+static int cgroup_cpu_limit(void) {
+    FILE *f = fopen("/proc/self/cgroup", "r");
+    if (!f) return 0;
     
-    snap_viewport_to_grid(h);
-    
-    int *buffer = malloc((size_t)w * h * sizeof(int));
-    if (!buffer) return -1;
-    
-    int workers = num_threads ? num_threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
-    if (workers < 1) workers = 1;
-    if (workers > h) workers = h;
-    
-    ThreadInfo *threads = malloc(sizeof(ThreadInfo) * workers);
-    WorkerTask *tasks = malloc(sizeof(WorkerTask) * workers);
-    if (!threads || !tasks) {
-        free(buffer); free(threads); free(tasks);
-        return -1;
+    char line[512], dir[1024];
+    double limit = 0;
+    while (fgets(line, sizeof(line), f)) {
+        /* "hierarchy:controllers:path"; v2 has no controllers */
+        char *ctrl = strchr(line, ':'), *rel = ctrl ? strchr(ctrl + 1, ':') : NULL;
+        if (!rel) continue;
+        *ctrl++ = '\0';
+        *rel++ = '\0';
+        rel[strcspn(rel, "\n")] = '\0';
+        int v2 = !*ctrl;
+        char list[256];
+        snprintf(list, sizeof(list), ",%s,", ctrl);
+        if (!v2 && !strstr(list, ",cpu,")) continue;
+        
+        int base = snprintf(dir, sizeof(dir), v2 ? "/sys/fs/cgroup" : "/sys/fs/cgroup/%s", ctrl);
+        snprintf(dir + base, sizeof(dir) - base, "%s", rel);
+        for (;;) {
+            size_t len = strlen(dir);
+            while (len > (size_t)base && dir[len - 1] == '/') dir[--len] = '\0';
+            double cpus = cgroup_quota(dir, v2);
+            if (cpus > 0 && (limit == 0 || cpus < limit)) limit = cpus;
+            char *slash = strrchr(dir, '/');
+            if (len <= (size_t)base || !slash || slash < dir + base) break;
+            *slash = '\0';
+        }
     }
+    fclose(f);
+    if (limit == 0) return 0;
+    return limit < 1 ? 1 : (int)(limit + 0.5);
+}
+
+/* Default pool size: usable CPUs under the affinity mask and the quota */
+static int default_thread_count(void) {
+    cpu_set_t set;
+    int n = sched_getaffinity(0, sizeof(set), &set) == 0 ? CPU_COUNT(&set)
+                                                         : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int quota = cgroup_cpu_limit();
+    if (quota > 0 && quota < n) n = quota;
+    if (n < 1) n = 4;
+    return n > MAX_THREADS ? MAX_THREADS : n;
+}
+
+/* Fill pool_cpu for n workers according to affinity_mode */
+static void plan_affinity(int n) {
+    for (int i = 0; i < n; i++) pool_cpu[i] = -1;
+    cpu_set_t mask;
+    if (affinity_mode == AFFINITY_NONE || sched_getaffinity(0, sizeof(mask), &mask) != 0)
+        return;
     
-    int rows_each = h / workers;
-    int extra_rows = h % workers;
-    int current_row = 0;
+    /* Usable CPUs grouped by node; without NUMA information, one node */
+    static int cpus[CPU_SETSIZE];
+    int node_first[MAX_NUMA_NODES + 1], nodes = 0, count = 0;
+    for (int k = 0; affinity_mode == AFFINITY_SPREAD && k < MAX_NUMA_NODES; k++) {
+        char path[64], list[4096];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", k);
+        FILE *f = fopen(path, "r");
+        if (!f) continue;
+        int ok = fgets(list, sizeof(list), f) != NULL;
+        fclose(f);
+        if (!ok) continue;
+        cpu_set_t set;
+        parse_cpulist(list, &set);
+        CPU_AND(&set, &set, &mask);
+        node_first[nodes] = count;
+        for (int c = 0; c < CPU_SETSIZE; c++)
+            if (CPU_ISSET(c, &set)) cpus[count++] = c;
+        if (count > node_first[nodes]) nodes++;
+    }
+    if (nodes == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++)
+            if (CPU_ISSET(c, &mask)) cpus[count++] = c;
+        node_first[nodes++] = 0;
+    }
+    node_first[nodes] = count;
+    if (count == 0) return;
     
-    for (int i = 0; i < workers; i++) {
-        int row_count = rows_each + (i < extra_rows ? 1 : 0);
-        
-        tasks[i] = (WorkerTask){
-            .row_start = current_row,
-            .row_end = current_row + row_count,
-            .width = w, .height = h,
-            .max_iter = max_iter,
-            .xmin = view_xmin, .xmax = view_xmax,
-            .ymin = view_ymin, .ymax = view_ymax,
-            .julia_mode = julia_mode,
-            .julia_cr = julia_cr, .julia_ci = julia_ci,
-            .output = buffer
-        };
-        current_row += row_count;
-        
-        threads[i].created = (pthread_create(&threads[i].handle, NULL,
-                                             calculate_rows, &tasks[i]) == 0);
-        if (!threads[i].created) calculate_rows(&tasks[i]);
+    /* Worker i goes to node i % nodes and takes that node's next CPU */
+    int used[MAX_NUMA_NODES] = { 0 };
+    for (int i = 0; i < n; i++) {
+        int k = affinity_mode == AFFINITY_SPREAD ? i % nodes : 0;
+        int size = node_first[k + 1] - node_first[k];
+        int at = affinity_mode == AFFINITY_SPREAD ? used[k]++ : i;
+        pool_cpu[i] = cpus[node_first[k] + at % size];
+    }
+}
+
+/* Start up to n workers. Returns the number of threads that came up. */
+static int pool_start(int n) {
+    if (n > MAX_THREADS) n = MAX_THREADS;
+    plan_affinity(n);
+    for (int i = 0; i < n; i++) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (pool_cpu[i] >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(pool_cpu[i], &set);
+            pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+        }
+        pool_args[i].id = i;
+        int err = pthread_create(&pool.threads[i], &attr, pool_worker, &pool_args[i]);
+        pthread_attr_destroy(&attr);
+        if (err != 0) break;
+        pool.count++;
+    }
+    return pool.count;
+}
+
+/* Number of worker ids a job will be called with */
+static int pool_size(void) {
+    return pool.count > 0 ? pool.count : 1;
+}
+
+/* Start fn(ctx, id) on every worker id and return immediately */
+static void pool_submit(PoolJobFn fn, void *ctx) {
+    if (pool.count == 0) {
+        /* No threads could be started: run inline */
+        fn(ctx, 0);
+        pool.notify = 1;
+        pool_signal_done();
+        return;
     }
     
-    for (int i = 0; i < workers; i++)
-        if (threads[i].created) pthread_join(threads[i].handle, NULL);
+    pthread_mutex_lock(&pool.lock);
+    pool.job_fn = fn;
+    pool.job_ctx = ctx;
+    pool.pending = pool.count;
+    pool.notify = 1;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.job_cv);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+/* Wait until the current job has finished on every worker */
+static void pool_wait(void) {
+    pthread_mutex_lock(&pool.lock);
+    while (pool.pending > 0)
+        pthread_cond_wait(&pool.done_cv, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+/* Whether a submitted job is still running on some worker */
+static int pool_busy(void) {
+    pthread_mutex_lock(&pool.lock);
+    int busy = pool.pending > 0;
+    pthread_mutex_unlock(&pool.lock);
+    return busy;
+}
+
+/* Run fn(ctx, id) for every worker id and wait for all of them */
+static void pool_run(PoolJobFn fn, void *ctx) {
+    if (pool.count == 0) {
+        fn(ctx, 0);
+        return;
+    }
     
-    free(threads);
-    free(tasks);
+    pthread_mutex_lock(&pool.lock);
+    pool.job_fn = fn;
+    pool.job_ctx = ctx;
+    pool.pending = pool.count;
+    pool.notify = 0;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.job_cv);
+    while (pool.pending > 0)
+        pthread_cond_wait(&pool.done_cv, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+/*
+ * Share of a new buffer each pinned worker touches first: the same row
+ * bands static scheduling hands out, which steal's per-worker runs of
+ * tiles follow closely as well.
+ */
+typedef struct { char *data; size_t bytes; } TouchJob;
+
+static void touch_share(void *ctx, int worker_id) {
+    const TouchJob *t = ctx;
+    int n = pool_size();
+    size_t from = t->bytes / n * worker_id;
+    size_t to = worker_id == n - 1 ? t->bytes : t->bytes / n * (worker_id + 1);
+    memset(t->data + from, 0, to - from);
+}
+
+static void pool_first_touch(void *data, size_t bytes) {
+    if (affinity_mode == AFFINITY_NONE || pool.count < 2 || pool_busy()) return;
+    TouchJob t = { data, bytes };
+    pool_run(touch_share, &t);
+}
+
+static void pool_stop(void) {
+    pthread_mutex_lock(&pool.lock);
+    pool.shutdown = 1;
+    pthread_cond_broadcast(&pool.job_cv);
+    pthread_mutex_unlock(&pool.lock);
     
-    *out_buffer = buffer;
-    *out_w = w;
-    *out_h = h;
-    return 0;
+    for (int i = 0; i < pool.count; i++)
+        pthread_join(pool.threads[i], NULL);
+    pool.count = 0;
 }
 
 /* ========================================================================== */
-/*                            RENDERING                                       */
+/*                       FIXED-POINT ARITHMETIC                               */
 /* ========================================================================== */
 
-/* Build command line that recreates current view */
-static int build_cmdline(char *buf, size_t size) {
-    const char *pal = palettes[current_palette];
-    char *p = buf;
-    char *end = buf + size - 1;
-    
-    p += snprintf(p, end - p, "marcepan -x %.9g %.9g -y %.9g %.9g -i %d",
-                  view_xmin, view_xmax, view_ymin, view_ymax, max_iter);
+/*
+ * Just enough signed fixed-point arithmetic for deep zoom: the view origin
+ * and the reference orbit. Magnitudes are BIG_LIMBS base-2^32 digits with
+ * one integer limb on top, so values must stay below 2^32 in size; that
+ * holds for everything inside the escape radius.
+ */
+
+static int big_is_zero(const BigFix *a) {
+    for (int i = 0; i < BIG_LIMBS; i++)
+        if (a->limb[i]) return 0;
+    return 1;
+}
+
+static int big_cmp_mag(const BigFix *a, const BigFix *b) {
+    for (int i = BIG_LIMBS - 1; i >= 0; i--)
+        if (a->limb[i] != b->limb[i]) return a->limb[i] < b->limb[i] ? -1 : 1;
+    return 0;
+}
+
+/* r = a + b (signed); r may alias either operand */
+static void big_add(BigFix *r, const BigFix *a, const BigFix *b) {
+    if (a->neg == b->neg) {
+        uint64_t carry = 0;
+        for (int i = 0; i < BIG_LIMBS; i++) {
+            carry += (uint64_t)a->limb[i] + b->limb[i];
+            r->limb[i] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        r->neg = a->neg;
+    } else {
+        /* Subtract the smaller magnitude from the larger */
+        if (big_cmp_mag(a, b) < 0) { const BigFix *t = a; a = b; b = t; }
+        int neg = a->neg;
+        int64_t borrow = 0;
+        for (int i = 0; i < BIG_LIMBS; i++) {
+            int64_t d = (int64_t)a->limb[i] - b->limb[i] - borrow;
+            borrow = d < 0;
+            r->limb[i] = (uint32_t)d;
+        }
+        r->neg = neg;
+    }
+    if (big_is_zero(r)) r->neg = 0;
+}
+
+static void big_sub(BigFix *r, const BigFix *a, const BigFix *b) {
+    BigFix nb = *b;
+    nb.neg = !nb.neg;
+    big_add(r, a, &nb);
+}
+
+/* r = a * b, truncated to BIG_LIMBS; r may alias either operand */
+static void big_mul(BigFix *r, const BigFix *a, const BigFix *b) {
+    uint32_t t[2 * BIG_LIMBS] = {0};
+    for (int i = 0; i < BIG_LIMBS; i++) {
+        if (!a->limb[i]) continue;
+        uint64_t carry = 0;
+        for (int j = 0; j < BIG_LIMBS; j++) {
+            uint64_t cur = (uint64_t)a->limb[i] * b->limb[j] + t[i + j] + carry;
+            t[i + j] = (uint32_t)cur;
+            carry = cur >> 32;
+        }
+        t[i + BIG_LIMBS] = (uint32_t)carry;
+    }
+    int neg = a->neg != b->neg;
+    memcpy(r->limb, t + BIG_LIMBS - 1, sizeof(r->limb));
+    r->neg = neg && !big_is_zero(r);
+}
+
+/* Exact conversion; |d| must be below 2^32 */
+static void big_from_double(BigFix *r, double d) {
+    double x = fabs(d);
+    for (int i = BIG_LIMBS - 1; i >= 0; i--) {
+        double digit = floor(x);
+        r->limb[i] = (uint32_t)digit;
+        x = (x - digit) * 4294967296.0;
+    }
+    r->neg = d < 0 && !big_is_zero(r);
+}
+
+static double big_to_double(const BigFix *a) {
+    double d = 0;
+    for (int i = 0; i < BIG_LIMBS; i++)
+        d = d / 4294967296.0 + a->limb[i];
+    return a->neg ? -d : d;
+}
+
+/*
+ * Parse a plain or exponent-form decimal ("-0.743643887037158704752191506114774",
+ * "1.5e-3"). Digits beyond the available precision are ignored.
+ * Returns 0 on success, -1 if s is not a number or out of range.
+ */
+static int big_parse(BigFix *r, const char *s) {
+    char digits[1024];
+    int n = 0, point = -1, neg = 0;
     
-    if (!use_color && p < end) p += snprintf(p, end - p, " -nc");
-    if (!use_modulo && p < end) p += snprintf(p, end - p, " -m lin");
-    if (use_halfblock && p < end) p += snprintf(p, end - p, " -hb");
+    if (*s == '-' || *s == '+') neg = (*s++ == '-');
+    for (; *s; s++) {
+        if (*s == '.' && point < 0) point = n;
+        else if (*s >= '0' && *s <= '9' && n < (int)sizeof(digits)) digits[n++] = *s - '0';
+        else break;
+    }
+    if (n == 0) return -1;
+    if (point < 0) point = n;
+    if (*s == 'e' || *s == 'E') {
+        char *end;
+        long e = strtol(s + 1, &end, 10);
+        if (end == s + 1 || e < -1000 || e > 1000) return -1;
+        point += (int)e;
+        s = end;
+    }
+    if (*s) return -1;
     
-    if (julia_mode && p < end)
-        p += snprintf(p, end - p, " -j %.9g %.9g", julia_cr, julia_ci);
+    /* Integer part first (must fit the integer limb), then the fraction
+     * from its last digit up: x = (x + d) / 10 */
+    uint64_t ip = 0;
+    for (int i = 0; i < point; i++) {
+        ip = ip * 10 + (i < n ? digits[i] : 0);
+        if (ip >> 32) return -1;
+    }
+    memset(r, 0, sizeof(*r));
+    for (int i = n - 1; i >= (point > 0 ? point : 0); i--) {
+        uint64_t rem = digits[i];
+        for (int k = BIG_LIMBS - 2; k >= 0; k--) {
+            uint64_t cur = (rem << 32) | r->limb[k];
+            r->limb[k] = (uint32_t)(cur / 10);
+            rem = cur % 10;
+        }
+    }
+    /* Leading zeros implied by a negative decimal point position */
+    for (int i = point; i < 0; i++) {
+        uint64_t rem = 0;
+        for (int k = BIG_LIMBS - 2; k >= 0; k--) {
+            uint64_t cur = (rem << 32) | r->limb[k];
+            r->limb[k] = (uint32_t)(cur / 10);
+            rem = cur % 10;
+        }
+    }
+    r->limb[BIG_LIMBS - 1] = (uint32_t)ip;
+    r->neg = neg && !big_is_zero(r);
+    return 0;
+}
+
+/* Format a rounded to the given number of decimals */
+static int big_format(char *buf, size_t size, const BigFix *a, int decimals) {
+    if (size < 16) return 0;
+    char *p = buf, *end = buf + size - 1;
     
-    if (p < end) p += snprintf(p, end - p, " -col %d", current_color_scheme + 1);
+    BigFix frac, half;
+    char num[16];
+    snprintf(num, sizeof(num), "5e-%d", decimals + 1);
+    big_parse(&half, num);
+    half.neg = a->neg;
+    big_add(&frac, a, &half);
     
-    /* Palette: use -pal N for builtins, --symbols '...' for custom */
-    if (current_palette < (int)BUILTIN_PALETTE_COUNT && p < end) {
-        p += snprintf(p, end - p, " -pal %d", current_palette + 1);
-        /* Also show the actual palette string for reference (not copy-paste safe) */
-        p += snprintf(p, end - p, " | \"%s\"", pal);
-    } else if (p < end) {
-        /* Custom palette - use single quotes with escaping */
-        p += snprintf(p, end - p, " --symbols '");
-        for (const char *s = pal; *s && p < end - 10; s++) {
-            if (*s == '\'') {
-                memcpy(p, "'\\''", 4);
-                p += 4;
-            } else {
-                *p++ = *s;
-            }
+    p += snprintf(p, end - p, "%s%u", frac.neg ? "-" : "", frac.limb[BIG_LIMBS - 1]);
+    frac.limb[BIG_LIMBS - 1] = 0;
+    if (decimals > 0 && p < end) *p++ = '.';
+    for (int d = 0; d < decimals && p < end; d++) {
+        uint64_t carry = 0;
+        for (int k = 0; k < BIG_LIMBS - 1; k++) {
+            uint64_t cur = (uint64_t)frac.limb[k] * 10 + carry;
+            frac.limb[k] = (uint32_t)cur;
+            carry = cur >> 32;
         }
-        if (p < end) *p++ = '\'';
+        *p++ = (char)('0' + carry);
     }
-    
+    *p = '\0';
     return (int)(p - buf);
 }
 
+/* ========================================================================== */
+/*                       FRACTAL CALCULATION                                  */
+/* ========================================================================== */
+
+typedef struct DeepOrbit DeepOrbit;
+
 /*
- * Render with half-blocks: each output row shows 2 calculation rows.
- * Uses '▀' (upper half) with FG=top, BG=bottom.
- * 
- * Logic for each cell:
- *   Both in set     → space (no color)
- *   Top in set      → '▄' with FG=bottom color, BG=black
- *   Bottom in set   → '▀' with FG=top color, BG=black  
- *   Neither in set  → '▀' with FG=top color, BG=bottom color
- * 
- * In monochrome mode: use grayscale based on iteration count.
+ * Where an orbit stopped at max_iter, so a deeper frame can continue it
+ * (see resume_rect). zr = NaN marks a pixel known never to escape, zr =
+ * inf one whose orbit was not kept. For perturbation the point holds dz
+ * and, in sr, the reference index.
  */
-static char *render_halfblock(char *p, const int *iterations, int w, int h,
-                              const uint8_t *colors) {
-    for (int y = 0; y < h; y += 2) {
-        const int *row_top = iterations + y * w;
-        const int *row_bot = (y + 1 < h) ? iterations + (y + 1) * w : row_top;
-        
-        for (int x = 0; x < w; x++) {
-            int n_top = row_top[x];
-            int n_bot = row_bot[x];
-            
-            int in_set_top = (n_top >= max_iter);
-            int in_set_bot = (n_bot >= max_iter);
-            
-            if (in_set_top && in_set_bot) {
-                /* Both in set - empty space, reset any color */
-                memcpy(p, "\x1b[0m ", 5);
-                p += 5;
-            } else if (in_set_top) {
-                /* Top in set (black), bottom has color - lower half block */
-                int c_bot = use_color ? colors[n_bot % 16] : (232 + (n_bot % 24));
-                p += sprintf(p, "\x1b[38;5;%d;49m▄", c_bot);
-            } else if (in_set_bot) {
-                /* Bottom in set (black), top has color - upper half block */
-                int c_top = use_color ? colors[n_top % 16] : (232 + (n_top % 24));
-                p += sprintf(p, "\x1b[38;5;%d;49m▀", c_top);
-            } else {
-                /* Neither in set - upper half with FG=top, BG=bottom */
-                int c_top = use_color ? colors[n_top % 16] : (232 + (n_top % 24));
-                int c_bot = use_color ? colors[n_bot % 16] : (232 + (n_bot % 24));
-                p += sprintf(p, "\x1b[38;5;%d;48;5;%dm▀", c_top, c_bot);
-            }
-        }
-        /* Reset and newline */
-        memcpy(p, "\x1b[0m\n", 5);
-        p += 5;
-    }
-    return p;
+typedef struct {
+    double zr, zi;
+    double sr, si;                /* Periodicity reference point */
+} OrbitPoint;
+
+#define ORBIT_INTERIOR(o)  isnan((o)->zr)
+#define ORBIT_UNKNOWN(o)   isinf((o)->zr)
+
+/* Frame parameters shared by every worker and tile of one computation */
+typedef struct {
+    int width, height;
+    int max_iter;
+    double dx, dy;                /* Pixel spacing */
+    double gx0, gy0;              /* Grid index of column 0 and row 0 */
+    int julia_mode;
+    double julia_cr, julia_ci;
+    int interior_check;           /* Cardioid/bulb test + periodicity */
+    double period_eps2;           /* Squared orbit distance that counts as a cycle */
+    Precision precision;          /* Tier the kernels iterate in; double for deep */
+    const DeepOrbit *deep;        /* Perturbation reference, NULL for plain views */
+    int deep_gen;                 /* Generation of that reference, 0 if none */
+    IterCount *output;
+    OrbitPoint *orbits;           /* Final orbit of every pixel, NULL if not kept */
+} WorkerTask;
+
+/* A region of the iteration buffer, [x0, x1) x [y0, y1) */
+typedef struct { int x0, y0, x1, y1; } Rect;
+
+/*
+ * Escape-time kernels. Each one iterates a run of pixels along a row
+ * (span) or down a column and writes the iteration counts to the task's
+ * output. Pixel (col, row) sits at ((gx0 + col) * dx, (gy0 - row) * dy),
+ * so its value depends only on its grid position. All kernels compute
+ * coordinates and z = z² + c with the same operations in the same order,
+ * so every kernel produces exactly the same counts as the scalar one.
+ *
+ * Mandelbrot: z₀ = 0, c = pixel position, iterate z = z² + c
+ * Julia:     z₀ = pixel position, c = fixed constant, iterate z = z² + c
+ *
+ * With interior_check set, pixels that provably never escape are given
+ * max_iter early: Mandelbrot points inside the main cardioid or the
+ * period-2 bulb are recognized in closed form, and any orbit that returns
+ * to within period_eps2 of a saved point has settled into a cycle. The
+ * saved point is refreshed Brent-style at iterations 1, 3, 7, 15, ... so
+ * cycles of any length are caught; the schedule depends only on the
+ * iteration number, which lets vector lanes share it.
+ *
+ * With task->orbits set, kernels also record each pixel's OrbitPoint.
+ */
+typedef void (*SpanKernel)(const WorkerTask *task, int row,
+                           int col_start, int col_end, IterCount *out_row);
+typedef void (*ColumnKernel)(const WorkerTask *task, int col,
+                             int row_start, int row_end);
+
+#define PERIOD_EPS_FRACTION  1e-6  /* Cycle tolerance relative to pixel spacing */
+#define PERIOD_EPS_FLOAT     (4 * FLT_EPSILON)    /* Its floor for float orbits */
+
+/* Cycle tolerance for the task's spacing and precision */
+static void set_period_eps(WorkerTask *task) {
+    double eps = task->dx * PERIOD_EPS_FRACTION;
+    if (task->precision == PREC_FLOAT && eps < PERIOD_EPS_FLOAT) eps = PERIOD_EPS_FLOAT;
+    task->period_eps2 = eps * eps;
+}
+
+static inline int in_main_bulbs(double x, double y) {
+    double y2 = y * y;
+    double xq = x - 0.25;
+    double q = xq * xq + y2;
+    if (q * (q + xq) <= 0.25 * y2) return 1;          /* Main cardioid */
+    double xb = x + 1.0;
+    return xb * xb + y2 <= 0.0625;                     /* Period-2 bulb */
 }
 
 /*
- * Standard ASCII rendering (original method)
- * Returns pointer to end of written data.
+ * Scalar escape loops, continuing the orbit in o from iteration n. On
+ * reaching max_n, o holds where the orbit stopped (zr = NaN for a cycle).
  */
-static char *render_ascii(char *p, const int *iterations, int w, int h,
-                          const char *pal, int pal_len, const uint8_t *colors) {
-    int last_color = -1;
+static inline int iterate_periodic(OrbitPoint *o, double cr, double ci,
+                                   int n, int max_n, double eps2) {
+    double zr = o->zr, zi = o->zi, sr = o->sr, si = o->si;
+    int period = 1, next_save = 1;
+    while (next_save <= n) {      /* Brent schedule at iteration n */
+        period *= 2;
+        next_save += period;
+    }
     
-    for (int row = 0; row < h; row++) {
-        const int *iter_row = iterations + row * w;
+    for (int iter = n; iter < max_n; iter++) {
+        double zr2 = zr * zr;
+        double zi2 = zi * zi;
+        if (zr2 + zi2 > 4.0) return iter;
+        zi = 2 * zr * zi + ci;
+        zr = zr2 - zi2 + cr;
         
-        for (int col = 0; col < w; col++) {
-            int n = iter_row[col];
-            char ch = iteration_to_char(n, max_iter, pal, pal_len);
-            
-            if (use_color && ch != FILL_CHAR) {
-                int color = iteration_to_color(n, max_iter, colors);
-                if (color != last_color) {
-                    p += sprintf(p, "\x1b[38;5;%dm", color);
-                    last_color = color;
-                }
-            } else if (last_color != -1) {
-                memcpy(p, "\x1b[0m", 4);
-                p += 4;
-                last_color = -1;
-            }
-            *p++ = ch;
+        double er = zr - sr, ei = zi - si;
+        if (er * er + ei * ei < eps2) {
+            o->zr = NAN;
+            return max_n;
         }
-        
-        if (last_color != -1) {
-            memcpy(p, "\x1b[0m", 4);
-            p += 4;
-            last_color = -1;
+        if (iter + 1 == next_save) {
+            sr = zr; si = zi;
+            period *= 2;
+            next_save += period;
         }
-        *p++ = '\n';
     }
-    return p;
+    *o = (OrbitPoint){ zr, zi, sr, si };
+    return max_n;
 }
 
-static void render_frame(const int *iterations, int w, int h) {
-    const char *pal = palettes[current_palette];
-    int pal_len = (int)strlen(pal);
-    const uint8_t *colors = color_schemes[current_color_scheme];
-    
-    size_t buf_size = (size_t)w * h * OUTBUF_PER_CELL + 1024;
-    char *buffer = malloc(buf_size);
-    if (!buffer) return;
-    
-    char *p = buffer;
-    
-    /* Header */
-    if (!batch_mode) {
-        memcpy(p, "\x1b[2J\x1b[H", 7);
-        p += 7;
-        
-        if (status_message[0]) {
-            p += sprintf(p, "%s\n", status_message);
-        } else {
-            p += build_cmdline(p, 512);
-            *p++ = '\n';
-        }
+static inline int iterate_plain(OrbitPoint *o, double cr, double ci, int n, int max_n) {
+    double zr = o->zr, zi = o->zi;
+    int iter = n;
+    while (iter < max_n) {
+        double zr2 = zr * zr;
+        double zi2 = zi * zi;
+        if (zr2 + zi2 > 4.0) return iter;
+        zi = 2 * zr * zi + ci;
+        zr = zr2 - zi2 + cr;
+        iter++;
     }
+    o->zr = zr; o->zi = zi;
+    return iter;
+}
+
+/* The constant c of pixel (px, py) */
+static inline void pixel_c(const WorkerTask *task, double px, double py, double *cr, double *ci) {
+    if (task->julia_mode) {
+        *cr = task->julia_cr;
+        *ci = task->julia_ci;
+    } else {
+        *cr = px;
+        *ci = py;
+    }
+}
+
+/* Iteration count of the point (px, py); its orbit goes to o if not NULL */
+static inline int escape_scalar(const WorkerTask *task, double px, double py, OrbitPoint *o) {
+    double zr, zi, cr, ci;
     
-    /* Render fractal */
-    if (use_halfblock) {
-        p = render_halfblock(p, iterations, w, h, colors);
+    if (task->julia_mode) {
+        /* Julia: z starts at pixel, c is constant */
+        zr = px; zi = py;
+        cr = task->julia_cr;
+        ci = task->julia_ci;
     } else {
-        p = render_ascii(p, iterations, w, h, pal, pal_len, colors);
+        /* Mandelbrot: z starts at 0, c is pixel */
+        zr = 0; zi = 0;
+        cr = px; ci = py;
     }
     
-    safe_write(STDOUT_FILENO, buffer, (size_t)(p - buffer));
-    free(buffer);
+    OrbitPoint tmp, *orbit = o ? o : &tmp;
+    *orbit = (OrbitPoint){ zr, zi, zr, zi };
+    if (task->interior_check && !task->julia_mode && in_main_bulbs(cr, ci)) {
+        orbit->zr = NAN;
+        return task->max_iter;
+    }
+    if (task->interior_check)
+        return iterate_periodic(orbit, cr, ci, 0, task->max_iter, task->period_eps2);
+    return iterate_plain(orbit, cr, ci, 0, task->max_iter);
+}
+
+/* Orbit slot of pixel (col, row), NULL if orbits are not kept */
+static inline OrbitPoint *orbit_at(const WorkerTask *task, int col, int row) {
+    return task->orbits ? task->orbits + (size_t)row * task->width + col : NULL;
+}
+
+/* Record n vector lanes of final orbits, pixel i + k * step for lane k */
+static inline void orbit_put(const WorkerTask *task, size_t i, size_t step, int n,
+                             const double *zr, const double *zi,
+                             const double *sr, const double *si) {
+    for (int k = 0; k < n; k++)
+        task->orbits[i + k * step] = (OrbitPoint){ zr[k], zi[k], sr[k], si[k] };
+}
+
+static inline void orbit_put_f32(const WorkerTask *task, size_t i, size_t step, int n,
+                                 const float *zr, const float *zi,
+                                 const float *sr, const float *si) {
+    for (int k = 0; k < n; k++)
+        task->orbits[i + k * step] = (OrbitPoint){ zr[k], zi[k], sr[k], si[k] };
+}
+
+static void span_scalar(const WorkerTask *task, int row,
+                        int col_start, int col_end, IterCount *out_row) {
+    double py = (task->gy0 - row) * task->dy;
+    for (int col = col_start; col < col_end; col++)
+        out_row[col] = escape_scalar(task, (task->gx0 + col) * task->dx, py,
+                                     orbit_at(task, col, row));
+}
+
+static void column_scalar(const WorkerTask *task, int col, int row_start, int row_end) {
+    double px = (task->gx0 + col) * task->dx;
+    for (int row = row_start; row < row_end; row++)
+        task->output[row * task->width + col] =
+            escape_scalar(task, px, (task->gy0 - row) * task->dy, orbit_at(task, col, row));
+}
+
+/*
+ * Single-precision tier: the loops above in float, for views coarse enough
+ * that float rounding stays well below a pixel (see view_precision), so
+ * vector kernels fit twice the lanes. Pixel positions are still computed
+ * in double and rounded once; every float kernel then matches the scalar
+ * float one exactly, just as the double kernels match escape_scalar().
+ * Orbits are kept as floats widened to double, which is exact.
+ */
+static inline int in_main_bulbs_f32(float x, float y) {
+    float y2 = y * y;
+    float xq = x - 0.25f;
+    float q = xq * xq + y2;
+    if (q * (q + xq) <= 0.25f * y2) return 1;
+    float xb = x + 1.0f;
+    return xb * xb + y2 <= 0.0625f;
+}
+
+static inline int iterate_periodic_f32(OrbitPoint *o, float cr, float ci,
+                                       int n, int max_n, float eps2) {
+    float zr = (float)o->zr, zi = (float)o->zi, sr = (float)o->sr, si = (float)o->si;
+    int period = 1, next_save = 1;
+    while (next_save <= n) {
+        period *= 2;
+        next_save += period;
+    }
+    
+    for (int iter = n; iter < max_n; iter++) {
+        float zr2 = zr * zr;
+        float zi2 = zi * zi;
+        if (zr2 + zi2 > 4.0f) return iter;
+        zi = 2 * zr * zi + ci;
+        zr = zr2 - zi2 + cr;
+        
+        float er = zr - sr, ei = zi - si;
+        if (er * er + ei * ei < eps2) {
+            o->zr = NAN;
+            return max_n;
+        }
+        if (iter + 1 == next_save) {
+            sr = zr; si = zi;
+            period *= 2;
+            next_save += period;
+        }
+    }
+    *o = (OrbitPoint){ zr, zi, sr, si };
+    return max_n;
+}
+
+static inline int iterate_plain_f32(OrbitPoint *o, float cr, float ci, int n, int max_n) {
+    float zr = (float)o->zr, zi = (float)o->zi;
+    int iter = n;
+    while (iter < max_n) {
+        float zr2 = zr * zr;
+        float zi2 = zi * zi;
+        if (zr2 + zi2 > 4.0f) return iter;
+        zi = 2 * zr * zi + ci;
+        zr = zr2 - zi2 + cr;
+        iter++;
+    }
+    o->zr = zr; o->zi = zi;
+    return iter;
+}
+
+static inline int escape_f32(const WorkerTask *task, double px, double py, OrbitPoint *o) {
+    float x = (float)px, y = (float)py;
+    float zr, zi, cr, ci;
+    
+    if (task->julia_mode) {
+        zr = x; zi = y;
+        cr = (float)task->julia_cr;
+        ci = (float)task->julia_ci;
+    } else {
+        zr = 0; zi = 0;
+        cr = x; ci = y;
+    }
+    
+    OrbitPoint tmp, *orbit = o ? o : &tmp;
+    *orbit = (OrbitPoint){ zr, zi, zr, zi };
+    if (task->interior_check && !task->julia_mode && in_main_bulbs_f32(cr, ci)) {
+        orbit->zr = NAN;
+        return task->max_iter;
+    }
+    if (task->interior_check)
+        return iterate_periodic_f32(orbit, cr, ci, 0, task->max_iter, (float)task->period_eps2);
+    return iterate_plain_f32(orbit, cr, ci, 0, task->max_iter);
+}
+
+static void span_scalar_f32(const WorkerTask *task, int row,
+                            int col_start, int col_end, IterCount *out_row) {
+    double py = (task->gy0 - row) * task->dy;
+    for (int col = col_start; col < col_end; col++)
+        out_row[col] = escape_f32(task, (task->gx0 + col) * task->dx, py,
+                                  orbit_at(task, col, row));
+}
+
+static void column_scalar_f32(const WorkerTask *task, int col, int row_start, int row_end) {
+    double px = (task->gx0 + col) * task->dx;
+    for (int row = row_start; row < row_end; row++)
+        task->output[row * task->width + col] =
+            escape_f32(task, px, (task->gy0 - row) * task->dy, orbit_at(task, col, row));
+}
+
+/*
+ * Extended tier: long double (a 64-bit mantissa on x86) for Julia views
+ * past DEEP_SPACING, where perturbation does not apply; grid indices are
+ * exact, so positions keep the extra bits. Scalar only. Orbits are not
+ * kept, an OrbitPoint could not hold them.
+ */
+static int escape_long(const WorkerTask *task, long double px, long double py) {
+    long double zr, zi, cr, ci;
+    int max_n = task->max_iter;
+    
+    if (task->julia_mode) {
+        zr = px; zi = py;
+        cr = task->julia_cr;
+        ci = task->julia_ci;
+    } else {
+        zr = 0; zi = 0;
+        cr = px; ci = py;
+        long double y2 = ci * ci, xq = cr - 0.25L, q = xq * xq + y2, xb = cr + 1.0L;
+        if (task->interior_check &&
+            (q * (q + xq) <= 0.25L * y2 || xb * xb + y2 <= 0.0625L))
+            return max_n;
+    }
+    
+    long double sr = zr, si = zi, eps2 = task->period_eps2;
+    int period = 1, next_save = 1;
+    for (int iter = 0; iter < max_n; iter++) {
+        long double zr2 = zr * zr;
+        long double zi2 = zi * zi;
+        if (zr2 + zi2 > 4.0L) return iter;
+        zi = 2 * zr * zi + ci;
+        zr = zr2 - zi2 + cr;
+        
+        if (!task->interior_check) continue;
+        long double er = zr - sr, ei = zi - si;
+        if (er * er + ei * ei < eps2) return max_n;
+        if (iter + 1 == next_save) {
+            sr = zr; si = zi;
+            period *= 2;
+            next_save += period;
+        }
+    }
+    return max_n;
+}
+
+static void span_long(const WorkerTask *task, int row,
+                      int col_start, int col_end, IterCount *out_row) {
+    long double py = (task->gy0 - row) * (long double)task->dy;
+    for (int col = col_start; col < col_end; col++)
+        out_row[col] = escape_long(task, (task->gx0 + col) * (long double)task->dx, py);
+}
+
+static void column_long(const WorkerTask *task, int col, int row_start, int row_end) {
+    long double px = (task->gx0 + col) * (long double)task->dx;
+    for (int row = row_start; row < row_end; row++)
+        task->output[row * task->width + col] =
+            escape_long(task, px, (task->gy0 - row) * (long double)task->dy);
+}
+
+/*
+ * Index of vector lane k when a run starting at i is cut short at last:
+ * surplus lanes repeat the final pixel, so a partial vector never costs
+ * more than the pixels it stands in for.
+ */
+#define TAIL_LANE(i, k, last)  ((i) + (k) < (last) ? (i) + (k) : (last))
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/*
+ * AVX2: 4 pixels per vector. A lane stays active while |z|² is not greater
+ * than 4 (NGT_UQ keeps NaN lanes running, like the scalar '>' test), and
+ * only active lanes advance their counter. The loop ends once every lane
+ * has escaped or max_iter is reached.
+ */
+__attribute__((target("avx2")))
+static inline __m256d bulbs_avx2(__m256d x, __m256d y) {
+    __m256d y2 = _mm256_mul_pd(y, y);
+    __m256d xq = _mm256_sub_pd(x, _mm256_set1_pd(0.25));
+    __m256d q = _mm256_add_pd(_mm256_mul_pd(xq, xq), y2);
+    __m256d card = _mm256_cmp_pd(_mm256_mul_pd(q, _mm256_add_pd(q, xq)),
+                                 _mm256_mul_pd(_mm256_set1_pd(0.25), y2), _CMP_LE_OQ);
+    __m256d xb = _mm256_add_pd(x, _mm256_set1_pd(1.0));
+    __m256d bulb = _mm256_cmp_pd(_mm256_add_pd(_mm256_mul_pd(xb, xb), y2),
+                                 _mm256_set1_pd(0.0625), _CMP_LE_OQ);
+    return _mm256_or_pd(card, bulb);
+}
+
+/*
+ * Iteration counts of the 4 points (px, py), as uint16 in the low 64 bits.
+ * If st is not NULL it receives zr, zi, sr, si of every lane (zr = NaN
+ * for lanes that escaped or were proven interior).
+ */
+__attribute__((target("avx2")))
+static inline __m128i escape_avx2(const WorkerTask *task, __m256d px, __m256d py,
+                                  double st[4][4]) {
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d vmax = _mm256_set1_pd(task->max_iter);
+    const __m256d eps2 = _mm256_set1_pd(task->period_eps2);
+    const int check = task->interior_check;
+    __m256d zr, zi, cr, ci;
+    
+    if (task->julia_mode) {
+        zr = px; zi = py;
+        cr = _mm256_set1_pd(task->julia_cr);
+        ci = _mm256_set1_pd(task->julia_ci);
+    } else {
+        zr = _mm256_setzero_pd(); zi = _mm256_setzero_pd();
+        cr = px; ci = py;
+    }
+    
+    __m256d active = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    __m256d count = _mm256_setzero_pd();
+    
+    if (check && !task->julia_mode) {
+        __m256d inside = bulbs_avx2(cr, ci);
+        count = _mm256_blendv_pd(count, vmax, inside);
+        active = _mm256_andnot_pd(inside, active);
+    }
+    
+    __m256d sr = zr, si = zi;
+    int period = 1, next_save = 1;
+    
+    for (int iter = 0; iter < task->max_iter; iter++) {
+        __m256d zr2 = _mm256_mul_pd(zr, zr);
+        __m256d zi2 = _mm256_mul_pd(zi, zi);
+        __m256d mag = _mm256_add_pd(zr2, zi2);
+        active = _mm256_and_pd(active, _mm256_cmp_pd(mag, four, _CMP_NGT_UQ));
+        if (_mm256_movemask_pd(active) == 0) break;
+        count = _mm256_add_pd(count, _mm256_and_pd(active, one));
+        zi = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(two, zr), zi), ci);
+        zr = _mm256_add_pd(_mm256_sub_pd(zr2, zi2), cr);
+        
+        if (check) {
+            __m256d er = _mm256_sub_pd(zr, sr), ei = _mm256_sub_pd(zi, si);
+            __m256d d2 = _mm256_add_pd(_mm256_mul_pd(er, er), _mm256_mul_pd(ei, ei));
+            __m256d cyc = _mm256_and_pd(active, _mm256_cmp_pd(d2, eps2, _CMP_LT_OQ));
+            count = _mm256_blendv_pd(count, vmax, cyc);
+            active = _mm256_andnot_pd(cyc, active);
+            if (iter + 1 == next_save) {
+                sr = zr; si = zi;
+                period *= 2;
+                next_save += period;
+            }
+        }
+    }
+    
+    if (st) {
+        _mm256_storeu_pd(st[0], _mm256_blendv_pd(_mm256_set1_pd(NAN), zr, active));
+        _mm256_storeu_pd(st[1], zi);
+        _mm256_storeu_pd(st[2], sr);
+        _mm256_storeu_pd(st[3], si);
+    }
+    
+    __m128i n = _mm256_cvtpd_epi32(count);
+    return _mm_packus_epi32(n, n);
+}
+
+__attribute__((target("avx2")))
+static void span_avx2(const WorkerTask *task, int row,
+                      int col_start, int col_end, IterCount *out_row) {
+    const __m256d vdx = _mm256_set1_pd(task->dx);
+    const __m256d vgx0 = _mm256_set1_pd(task->gx0);
+    const __m256d vpy = _mm256_set1_pd((task->gy0 - row) * task->dy);
+    double st[4][4], (*keep)[4] = task->orbits ? st : NULL;
+    size_t base = (size_t)row * task->width;
+    
+    int col = col_start;
+    for (; col + 4 <= col_end; col += 4) {
+        __m256d idx = _mm256_set_pd(col + 3, col + 2, col + 1, col);
+        __m256d px = _mm256_mul_pd(_mm256_add_pd(vgx0, idx), vdx);
+        _mm_storel_epi64((__m128i *)(out_row + col), escape_avx2(task, px, vpy, keep));
+        if (keep) orbit_put(task, base + col, 1, 4, st[0], st[1], st[2], st[3]);
+    }
+    
+    if (col < col_end) {
+        IterCount counts[4];
+        int last = col_end - 1;
+        __m256d idx = _mm256_set_pd(TAIL_LANE(col, 3, last), TAIL_LANE(col, 2, last),
+                                    TAIL_LANE(col, 1, last), col);
+        __m256d px = _mm256_mul_pd(_mm256_add_pd(vgx0, idx), vdx);
+        _mm_storel_epi64((__m128i *)counts, escape_avx2(task, px, vpy, keep));
+        memcpy(out_row + col, counts, (size_t)(col_end - col) * sizeof(IterCount));
+        if (keep) orbit_put(task, base + col, 1, col_end - col, st[0], st[1], st[2], st[3]);
+    }
+}
+
+__attribute__((target("avx2")))
+static void column_avx2(const WorkerTask *task, int col, int row_start, int row_end) {
+    const __m256d vdy = _mm256_set1_pd(task->dy);
+    const __m256d vgy0 = _mm256_set1_pd(task->gy0);
+    const __m256d vpx = _mm256_set1_pd((task->gx0 + col) * task->dx);
+    IterCount *out = task->output + col;
+    IterCount counts[4];
+    double st[4][4], (*keep)[4] = task->orbits ? st : NULL;
+    
+    int last = row_end - 1;
+    for (int row = row_start; row < row_end; row += 4) {
+        __m256d idx = _mm256_set_pd(TAIL_LANE(row, 3, last), TAIL_LANE(row, 2, last),
+                                    TAIL_LANE(row, 1, last), row);
+        __m256d py = _mm256_mul_pd(_mm256_sub_pd(vgy0, idx), vdy);
+        _mm_storel_epi64((__m128i *)counts, escape_avx2(task, vpx, py, keep));
+        int n = row_end - row < 4 ? row_end - row : 4;
+        for (int k = 0; k < n; k++)
+            out[(row + k) * task->width] = counts[k];
+        if (keep)
+            orbit_put(task, (size_t)row * task->width + col, task->width, n,
+                      st[0], st[1], st[2], st[3]);
+    }
+}
+
+/* AVX2 float: the same loop over 8 lanes, matching escape_f32(); 8 x uint16 out */
+__attribute__((target("avx2")))
+static inline __m128i escape_avx2_f32(const WorkerTask *task, __m256 px, __m256 py,
+                                      float st[4][8]) {
+    const __m256 four = _mm256_set1_ps(4.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 vmax = _mm256_set1_ps((float)task->max_iter);
+    const __m256 eps2 = _mm256_set1_ps((float)task->period_eps2);
+    const int check = task->interior_check;
+    __m256 zr, zi, cr, ci;
+    
+    if (task->julia_mode) {
+        zr = px; zi = py;
+        cr = _mm256_set1_ps((float)task->julia_cr);
+        ci = _mm256_set1_ps((float)task->julia_ci);
+    } else {
+        zr = _mm256_setzero_ps(); zi = _mm256_setzero_ps();
+        cr = px; ci = py;
+    }
+    
+    __m256 active = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    __m256 count = _mm256_setzero_ps();
+    
+    if (check && !task->julia_mode) {
+        __m256 y2 = _mm256_mul_ps(ci, ci);
+        __m256 xq = _mm256_sub_ps(cr, _mm256_set1_ps(0.25f));
+        __m256 q = _mm256_add_ps(_mm256_mul_ps(xq, xq), y2);
+        __m256 inside = _mm256_cmp_ps(_mm256_mul_ps(q, _mm256_add_ps(q, xq)),
+                                      _mm256_mul_ps(_mm256_set1_ps(0.25f), y2), _CMP_LE_OQ);
+        __m256 xb = _mm256_add_ps(cr, _mm256_set1_ps(1.0f));
+        inside = _mm256_or_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(xb, xb), y2),
+                                                    _mm256_set1_ps(0.0625f), _CMP_LE_OQ));
+        count = _mm256_blendv_ps(count, vmax, inside);
+        active = _mm256_andnot_ps(inside, active);
+    }
+    
+    __m256 sr = zr, si = zi;
+    int period = 1, next_save = 1;
+    
+    for (int iter = 0; iter < task->max_iter; iter++) {
+        __m256 zr2 = _mm256_mul_ps(zr, zr);
+        __m256 zi2 = _mm256_mul_ps(zi, zi);
+        __m256 mag = _mm256_add_ps(zr2, zi2);
+        active = _mm256_and_ps(active, _mm256_cmp_ps(mag, four, _CMP_NGT_UQ));
+        if (_mm256_movemask_ps(active) == 0) break;
+        count = _mm256_add_ps(count, _mm256_and_ps(active, one));
+        zi = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(two, zr), zi), ci);
+        zr = _mm256_add_ps(_mm256_sub_ps(zr2, zi2), cr);
+        
+        if (check) {
+            __m256 er = _mm256_sub_ps(zr, sr), ei = _mm256_sub_ps(zi, si);
+            __m256 d2 = _mm256_add_ps(_mm256_mul_ps(er, er), _mm256_mul_ps(ei, ei));
+            __m256 cyc = _mm256_and_ps(active, _mm256_cmp_ps(d2, eps2, _CMP_LT_OQ));
+            count = _mm256_blendv_ps(count, vmax, cyc);
+            active = _mm256_andnot_ps(cyc, active);
+            if (iter + 1 == next_save) {
+                sr = zr; si = zi;
+                period *= 2;
+                next_save += period;
+            }
+        }
+    }
+    
+    if (st) {
+        _mm256_storeu_ps(st[0], _mm256_blendv_ps(_mm256_set1_ps(NAN), zr, active));
+        _mm256_storeu_ps(st[1], zi);
+        _mm256_storeu_ps(st[2], sr);
+        _mm256_storeu_ps(st[3], si);
+    }
+    
+    __m256i n = _mm256_cvtps_epi32(count);
+    return _mm_packus_epi32(_mm256_castsi256_si128(n), _mm256_extracti128_si256(n, 1));
+}
+
+/* Eight double coordinates (a + idx) * d, rounded to float once */
+__attribute__((target("avx2")))
+static inline __m256 coords_avx2_f32(double a, double d, const double idx[8]) {
+    const __m256d va = _mm256_set1_pd(a), vd = _mm256_set1_pd(d);
+    __m256d lo = _mm256_mul_pd(_mm256_add_pd(va, _mm256_loadu_pd(idx)), vd);
+    __m256d hi = _mm256_mul_pd(_mm256_add_pd(va, _mm256_loadu_pd(idx + 4)), vd);
+    return _mm256_set_m128(_mm256_cvtpd_ps(hi), _mm256_cvtpd_ps(lo));
+}
+
+__attribute__((target("avx2")))
+static void span_avx2_f32(const WorkerTask *task, int row,
+                          int col_start, int col_end, IterCount *out_row) {
+    const __m256 vpy = _mm256_set1_ps((float)((task->gy0 - row) * task->dy));
+    float st[4][8], (*keep)[8] = task->orbits ? st : NULL;
+    size_t base = (size_t)row * task->width;
+    IterCount counts[8];
+    double idx[8];
+    
+    int last = col_end - 1;
+    for (int col = col_start; col < col_end; col += 8) {
+        for (int k = 0; k < 8; k++) idx[k] = TAIL_LANE(col, k, last);
+        __m256 px = coords_avx2_f32(task->gx0, task->dx, idx);
+        _mm_storeu_si128((__m128i *)counts, escape_avx2_f32(task, px, vpy, keep));
+        int n = col_end - col < 8 ? col_end - col : 8;
+        memcpy(out_row + col, counts, (size_t)n * sizeof(IterCount));
+        if (keep) orbit_put_f32(task, base + col, 1, n, st[0], st[1], st[2], st[3]);
+    }
+}
+
+__attribute__((target("avx2")))
+static void column_avx2_f32(const WorkerTask *task, int col, int row_start, int row_end) {
+    const __m256 vpx = _mm256_set1_ps((float)((task->gx0 + col) * task->dx));
+    IterCount *out = task->output + col;
+    float st[4][8], (*keep)[8] = task->orbits ? st : NULL;
+    IterCount counts[8];
+    double idx[8];
+    
+    int last = row_end - 1;
+    for (int row = row_start; row < row_end; row += 8) {
+        for (int k = 0; k < 8; k++) idx[k] = -(double)TAIL_LANE(row, k, last);
+        __m256 py = coords_avx2_f32(task->gy0, task->dy, idx);
+        _mm_storeu_si128((__m128i *)counts, escape_avx2_f32(task, vpx, py, keep));
+        int n = row_end - row < 8 ? row_end - row : 8;
+        for (int k = 0; k < n; k++)
+            out[(row + k) * task->width] = counts[k];
+        if (keep)
+            orbit_put_f32(task, (size_t)row * task->width + col, task->width, n,
+                          st[0], st[1], st[2], st[3]);
+    }
+}
+
+/* AVX-512: same scheme as AVX2 with 8 lanes and mask registers; 8 x uint16 out */
+__attribute__((target("avx512f")))
+static inline __m128i escape_avx512(const WorkerTask *task, __m512d px, __m512d py,
+                                    double st[4][8]) {
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d two = _mm512_set1_pd(2.0);
+    const __m512d vmax = _mm512_set1_pd(task->max_iter);
+    const __m512d eps2 = _mm512_set1_pd(task->period_eps2);
+    const int check = task->interior_check;
+    __m512d zr, zi, cr, ci;
+    
+    if (task->julia_mode) {
+        zr = px; zi = py;
+        cr = _mm512_set1_pd(task->julia_cr);
+        ci = _mm512_set1_pd(task->julia_ci);
+    } else {
+        zr = _mm512_setzero_pd(); zi = _mm512_setzero_pd();
+        cr = px; ci = py;
+    }
+    
+    __mmask8 active = 0xFF;
+    __m512d count = _mm512_setzero_pd();
+    
+    if (check && !task->julia_mode) {
+        __m512d y2 = _mm512_mul_pd(ci, ci);
+        __m512d xq = _mm512_sub_pd(cr, _mm512_set1_pd(0.25));
+        __m512d q = _mm512_add_pd(_mm512_mul_pd(xq, xq), y2);
+        __mmask8 inside = _mm512_cmp_pd_mask(_mm512_mul_pd(q, _mm512_add_pd(q, xq)),
+                                             _mm512_mul_pd(_mm512_set1_pd(0.25), y2),
+                                             _CMP_LE_OQ);
+        __m512d xb = _mm512_add_pd(cr, _mm512_set1_pd(1.0));
+        inside |= _mm512_cmp_pd_mask(_mm512_add_pd(_mm512_mul_pd(xb, xb), y2),
+                                     _mm512_set1_pd(0.0625), _CMP_LE_OQ);
+        count = _mm512_mask_mov_pd(count, inside, vmax);
+        active &= (__mmask8)~inside;
+    }
+    
+    __m512d sr = zr, si = zi;
+    int period = 1, next_save = 1;
+    
+    for (int iter = 0; iter < task->max_iter; iter++) {
+        __m512d zr2 = _mm512_mul_pd(zr, zr);
+        __m512d zi2 = _mm512_mul_pd(zi, zi);
+        __m512d mag = _mm512_add_pd(zr2, zi2);
+        active = _mm512_mask_cmp_pd_mask(active, mag, four, _CMP_NGT_UQ);
+        if (!active) break;
+        count = _mm512_mask_add_pd(count, active, count, one);
+        zi = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(two, zr), zi), ci);
+        zr = _mm512_add_pd(_mm512_sub_pd(zr2, zi2), cr);
+        
+        if (check) {
+            __m512d er = _mm512_sub_pd(zr, sr), ei = _mm512_sub_pd(zi, si);
+            __m512d d2 = _mm512_add_pd(_mm512_mul_pd(er, er), _mm512_mul_pd(ei, ei));
+            __mmask8 cyc = _mm512_mask_cmp_pd_mask(active, d2, eps2, _CMP_LT_OQ);
+            count = _mm512_mask_mov_pd(count, cyc, vmax);
+            active &= (__mmask8)~cyc;
+            if (iter + 1 == next_save) {
+                sr = zr; si = zi;
+                period *= 2;
+                next_save += period;
+            }
+        }
+    }
+    
+    if (st) {
+        _mm512_storeu_pd(st[0], _mm512_mask_blend_pd(active, _mm512_set1_pd(NAN), zr));
+        _mm512_storeu_pd(st[1], zi);
+        _mm512_storeu_pd(st[2], sr);
+        _mm512_storeu_pd(st[3], si);
+    }
+    
+    __m256i n = _mm512_cvtpd_epi32(count);
+    return _mm_packus_epi32(_mm256_castsi256_si128(n), _mm256_extracti128_si256(n, 1));
+}
+
+__attribute__((target("avx512f")))
+static void span_avx512(const WorkerTask *task, int row,
+                        int col_start, int col_end, IterCount *out_row) {
+    const __m512d vdx = _mm512_set1_pd(task->dx);
+    const __m512d vgx0 = _mm512_set1_pd(task->gx0);
+    const __m512d vpy = _mm512_set1_pd((task->gy0 - row) * task->dy);
+    double st[4][8], (*keep)[8] = task->orbits ? st : NULL;
+    size_t base = (size_t)row * task->width;
+    
+    int col = col_start;
+    for (; col + 8 <= col_end; col += 8) {
+        __m512d idx = _mm512_set_pd(col + 7, col + 6, col + 5, col + 4,
+                                    col + 3, col + 2, col + 1, col);
+        __m512d px = _mm512_mul_pd(_mm512_add_pd(vgx0, idx), vdx);
+        _mm_storeu_si128((__m128i *)(out_row + col), escape_avx512(task, px, vpy, keep));
+        if (keep) orbit_put(task, base + col, 1, 8, st[0], st[1], st[2], st[3]);
+    }
+    
+    if (col < col_end) {
+        IterCount counts[8];
+        int last = col_end - 1;
+        __m512d idx = _mm512_set_pd(TAIL_LANE(col, 7, last), TAIL_LANE(col, 6, last),
+                                    TAIL_LANE(col, 5, last), TAIL_LANE(col, 4, last),
+                                    TAIL_LANE(col, 3, last), TAIL_LANE(col, 2, last),
+                                    TAIL_LANE(col, 1, last), col);
+        __m512d px = _mm512_mul_pd(_mm512_add_pd(vgx0, idx), vdx);
+        _mm_storeu_si128((__m128i *)counts, escape_avx512(task, px, vpy, keep));
+        memcpy(out_row + col, counts, (size_t)(col_end - col) * sizeof(IterCount));
+        if (keep) orbit_put(task, base + col, 1, col_end - col, st[0], st[1], st[2], st[3]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void column_avx512(const WorkerTask *task, int col, int row_start, int row_end) {
+    const __m512d vdy = _mm512_set1_pd(task->dy);
+    const __m512d vgy0 = _mm512_set1_pd(task->gy0);
+    const __m512d vpx = _mm512_set1_pd((task->gx0 + col) * task->dx);
+    IterCount *out = task->output + col;
+    IterCount counts[8];
+    double st[4][8], (*keep)[8] = task->orbits ? st : NULL;
+    
+    int last = row_end - 1;
+    for (int row = row_start; row < row_end; row += 8) {
+        __m512d idx = _mm512_set_pd(TAIL_LANE(row, 7, last), TAIL_LANE(row, 6, last),
+                                    TAIL_LANE(row, 5, last), TAIL_LANE(row, 4, last),
+                                    TAIL_LANE(row, 3, last), TAIL_LANE(row, 2, last),
+                                    TAIL_LANE(row, 1, last), row);
+        __m512d py = _mm512_mul_pd(_mm512_sub_pd(vgy0, idx), vdy);
+        _mm_storeu_si128((__m128i *)counts, escape_avx512(task, vpx, py, keep));
+        int n = row_end - row < 8 ? row_end - row : 8;
+        for (int k = 0; k < n; k++)
+            out[(row + k) * task->width] = counts[k];
+        if (keep)
+            orbit_put(task, (size_t)row * task->width + col, task->width, n,
+                      st[0], st[1], st[2], st[3]);
+    }
+}
+
+/* AVX-512 float: 16 lanes, matching escape_f32(); 16 x uint16 out */
+__attribute__((target("avx512f")))
+static inline __m256i escape_avx512_f32(const WorkerTask *task, __m512 px, __m512 py,
+                                        float st[4][16]) {
+    const __m512 four = _mm512_set1_ps(4.0f);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 two = _mm512_set1_ps(2.0f);
+    const __m512 vmax = _mm512_set1_ps((float)task->max_iter);
+    const __m512 eps2 = _mm512_set1_ps((float)task->period_eps2);
+    const int check = task->interior_check;
+    __m512 zr, zi, cr, ci;
+    
+    if (task->julia_mode) {
+        zr = px; zi = py;
+        cr = _mm512_set1_ps((float)task->julia_cr);
+        ci = _mm512_set1_ps((float)task->julia_ci);
+    } else {
+        zr = _mm512_setzero_ps(); zi = _mm512_setzero_ps();
+        cr = px; ci = py;
+    }
+    
+    __mmask16 active = 0xFFFF;
+    __m512 count = _mm512_setzero_ps();
+    
+    if (check && !task->julia_mode) {
+        __m512 y2 = _mm512_mul_ps(ci, ci);
+        __m512 xq = _mm512_sub_ps(cr, _mm512_set1_ps(0.25f));
+        __m512 q = _mm512_add_ps(_mm512_mul_ps(xq, xq), y2);
+        __mmask16 inside = _mm512_cmp_ps_mask(_mm512_mul_ps(q, _mm512_add_ps(q, xq)),
+                                              _mm512_mul_ps(_mm512_set1_ps(0.25f), y2),
+                                              _CMP_LE_OQ);
+        __m512 xb = _mm512_add_ps(cr, _mm512_set1_ps(1.0f));
+        inside |= _mm512_cmp_ps_mask(_mm512_add_ps(_mm512_mul_ps(xb, xb), y2),
+                                     _mm512_set1_ps(0.0625f), _CMP_LE_OQ);
+        count = _mm512_mask_mov_ps(count, inside, vmax);
+        active &= (__mmask16)~inside;
+    }
+    
+    __m512 sr = zr, si = zi;
+    int period = 1, next_save = 1;
+    
+    for (int iter = 0; iter < task->max_iter; iter++) {
+        __m512 zr2 = _mm512_mul_ps(zr, zr);
+        __m512 zi2 = _mm512_mul_ps(zi, zi);
+        __m512 mag = _mm512_add_ps(zr2, zi2);
+        active = _mm512_mask_cmp_ps_mask(active, mag, four, _CMP_NGT_UQ);
+        if (!active) break;
+        count = _mm512_mask_add_ps(count, active, count, one);
+        zi = _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(two, zr), zi), ci);
+        zr = _mm512_add_ps(_mm512_sub_ps(zr2, zi2), cr);
+        
+        if (check) {
+            __m512 er = _mm512_sub_ps(zr, sr), ei = _mm512_sub_ps(zi, si);
+            __m512 d2 = _mm512_add_ps(_mm512_mul_ps(er, er), _mm512_mul_ps(ei, ei));
+            __mmask16 cyc = _mm512_mask_cmp_ps_mask(active, d2, eps2, _CMP_LT_OQ);
+            count = _mm512_mask_mov_ps(count, cyc, vmax);
+            active &= (__mmask16)~cyc;
+            if (iter + 1 == next_save) {
+                sr = zr; si = zi;
+                period *= 2;
+                next_save += period;
+            }
+        }
+    }
+    
+    if (st) {
+        _mm512_storeu_ps(st[0], _mm512_mask_blend_ps(active, _mm512_set1_ps(NAN), zr));
+        _mm512_storeu_ps(st[1], zi);
+        _mm512_storeu_ps(st[2], sr);
+        _mm512_storeu_ps(st[3], si);
+    }
+    
+    return _mm512_cvtusepi32_epi16(_mm512_cvtps_epi32(count));
+}
+
+/* Sixteen double coordinates (a + idx) * d, rounded to float once */
+__attribute__((target("avx512f")))
+static inline __m512 coords_avx512_f32(double a, double d, const double idx[16]) {
+    const __m512d va = _mm512_set1_pd(a), vd = _mm512_set1_pd(d);
+    __m512d lo = _mm512_mul_pd(_mm512_add_pd(va, _mm512_loadu_pd(idx)), vd);
+    __m512d hi = _mm512_mul_pd(_mm512_add_pd(va, _mm512_loadu_pd(idx + 8)), vd);
+    __m512 all = _mm512_castps256_ps512(_mm512_cvtpd_ps(lo));
+    return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(all),
+                                               _mm256_castps_pd(_mm512_cvtpd_ps(hi)), 1));
+}
+
+__attribute__((target("avx512f")))
+static void span_avx512_f32(const WorkerTask *task, int row,
+                            int col_start, int col_end, IterCount *out_row) {
+    const __m512 vpy = _mm512_set1_ps((float)((task->gy0 - row) * task->dy));
+    float st[4][16], (*keep)[16] = task->orbits ? st : NULL;
+    size_t base = (size_t)row * task->width;
+    IterCount counts[16];
+    double idx[16];
+    
+    int last = col_end - 1;
+    for (int col = col_start; col < col_end; col += 16) {
+        for (int k = 0; k < 16; k++) idx[k] = TAIL_LANE(col, k, last);
+        __m512 px = coords_avx512_f32(task->gx0, task->dx, idx);
+        _mm256_storeu_si256((__m256i *)counts, escape_avx512_f32(task, px, vpy, keep));
+        int n = col_end - col < 16 ? col_end - col : 16;
+        memcpy(out_row + col, counts, (size_t)n * sizeof(IterCount));
+        if (keep) orbit_put_f32(task, base + col, 1, n, st[0], st[1], st[2], st[3]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void column_avx512_f32(const WorkerTask *task, int col, int row_start, int row_end) {
+    const __m512 vpx = _mm512_set1_ps((float)((task->gx0 + col) * task->dx));
+    IterCount *out = task->output + col;
+    float st[4][16], (*keep)[16] = task->orbits ? st : NULL;
+    IterCount counts[16];
+    double idx[16];
+    
+    int last = row_end - 1;
+    for (int row = row_start; row < row_end; row += 16) {
+        for (int k = 0; k < 16; k++) idx[k] = -(double)TAIL_LANE(row, k, last);
+        __m512 py = coords_avx512_f32(task->gy0, task->dy, idx);
+        _mm256_storeu_si256((__m256i *)counts, escape_avx512_f32(task, vpx, py, keep));
+        int n = row_end - row < 16 ? row_end - row : 16;
+        for (int k = 0; k < n; k++)
+            out[(row + k) * task->width] = counts[k];
+        if (keep)
+            orbit_put_f32(task, (size_t)row * task->width + col, task->width, n,
+                          st[0], st[1], st[2], st[3]);
+    }
+}
+
+#endif /* x86 */
+
+#if defined(__aarch64__)
+
+/*
+ * NEON: 4 pixels as two 2-lane double vectors, interleaved so both halves
+ * share one loop. A lane drops out once |z|² > 4, as in the scalar loop.
+ */
+static inline void escape_neon(const WorkerTask *task, const float64x2_t px[2],
+                               const float64x2_t py[2], int counts[4], double st[4][4]) {
+    const float64x2_t four = vdupq_n_f64(4.0);
+    const float64x2_t two = vdupq_n_f64(2.0);
+    const uint64x2_t one = vdupq_n_u64(1);
+    const uint64x2_t vmax = vdupq_n_u64((uint64_t)task->max_iter);
+    const float64x2_t eps2 = vdupq_n_f64(task->period_eps2);
+    const int check = task->interior_check;
+    float64x2_t zr[2], zi[2], cr[2], ci[2], sr[2], si[2];
+    uint64x2_t active[2], count[2];
+    
+    for (int k = 0; k < 2; k++) {
+        if (task->julia_mode) {
+            zr[k] = px[k]; zi[k] = py[k];
+            cr[k] = vdupq_n_f64(task->julia_cr);
+            ci[k] = vdupq_n_f64(task->julia_ci);
+        } else {
+            zr[k] = vdupq_n_f64(0); zi[k] = vdupq_n_f64(0);
+            cr[k] = px[k]; ci[k] = py[k];
+        }
+        active[k] = vdupq_n_u64(~0ULL);
+        count[k] = vdupq_n_u64(0);
+        
+        if (check && !task->julia_mode) {
+            float64x2_t y2 = vmulq_f64(ci[k], ci[k]);
+            float64x2_t xq = vsubq_f64(cr[k], vdupq_n_f64(0.25));
+            float64x2_t q = vaddq_f64(vmulq_f64(xq, xq), y2);
+            uint64x2_t inside = vcleq_f64(vmulq_f64(q, vaddq_f64(q, xq)),
+                                          vmulq_f64(vdupq_n_f64(0.25), y2));
+            float64x2_t xb = vaddq_f64(cr[k], vdupq_n_f64(1.0));
+            inside = vorrq_u64(inside, vcleq_f64(vaddq_f64(vmulq_f64(xb, xb), y2),
+                                                 vdupq_n_f64(0.0625)));
+            count[k] = vbslq_u64(inside, vmax, count[k]);
+            active[k] = vbicq_u64(active[k], inside);
+        }
+        sr[k] = zr[k]; si[k] = zi[k];
+    }
+    
+    int period = 1, next_save = 1;
+    
+    for (int iter = 0; iter < task->max_iter; iter++) {
+        for (int k = 0; k < 2; k++) {
+            float64x2_t zr2 = vmulq_f64(zr[k], zr[k]);
+            float64x2_t zi2 = vmulq_f64(zi[k], zi[k]);
+            float64x2_t mag = vaddq_f64(zr2, zi2);
+            active[k] = vbicq_u64(active[k], vcgtq_f64(mag, four));
+            count[k] = vaddq_u64(count[k], vandq_u64(active[k], one));
+            zi[k] = vaddq_f64(vmulq_f64(vmulq_f64(two, zr[k]), zi[k]), ci[k]);
+            zr[k] = vaddq_f64(vsubq_f64(zr2, zi2), cr[k]);
+            
+            if (check) {
+                float64x2_t er = vsubq_f64(zr[k], sr[k]), ei = vsubq_f64(zi[k], si[k]);
+                float64x2_t d2 = vaddq_f64(vmulq_f64(er, er), vmulq_f64(ei, ei));
+                uint64x2_t cyc = vandq_u64(active[k], vcltq_f64(d2, eps2));
+                count[k] = vbslq_u64(cyc, vmax, count[k]);
+                active[k] = vbicq_u64(active[k], cyc);
+            }
+        }
+        if (check && iter + 1 == next_save) {
+            for (int k = 0; k < 2; k++) { sr[k] = zr[k]; si[k] = zi[k]; }
+            period *= 2;
+            next_save += period;
+        }
+        if (vmaxvq_u32(vreinterpretq_u32_u64(vorrq_u64(active[0], active[1]))) == 0)
+            break;
+    }
+    
+    for (int k = 0; k < 2; k++) {
+        counts[2 * k]     = (int)vgetq_lane_u64(count[k], 0);
+        counts[2 * k + 1] = (int)vgetq_lane_u64(count[k], 1);
+        if (st) {
+            vst1q_f64(st[0] + 2 * k, vbslq_f64(active[k], zr[k], vdupq_n_f64(NAN)));
+            vst1q_f64(st[1] + 2 * k, zi[k]);
+            vst1q_f64(st[2] + 2 * k, sr[k]);
+            vst1q_f64(st[3] + 2 * k, si[k]);
+        }
+    }
+}
+
+static void span_neon(const WorkerTask *task, int row,
+                      int col_start, int col_end, IterCount *out_row) {
+    const float64x2_t vdx = vdupq_n_f64(task->dx);
+    const float64x2_t vpy = vdupq_n_f64((task->gy0 - row) * task->dy);
+    const float64x2_t py[2] = { vpy, vpy };
+    
+    int counts[4], last = col_end - 1;
+    double st[4][4], (*keep)[4] = task->orbits ? st : NULL;
+    
+    for (int col = col_start; col < col_end; col += 4) {
+        double lo[2] = { task->gx0 + col, task->gx0 + TAIL_LANE(col, 1, last) };
+        double hi[2] = { task->gx0 + TAIL_LANE(col, 2, last),
+                         task->gx0 + TAIL_LANE(col, 3, last) };
+        float64x2_t px[2] = { vmulq_f64(vld1q_f64(lo), vdx), vmulq_f64(vld1q_f64(hi), vdx) };
+        escape_neon(task, px, py, counts, keep);
+        int n = col_end - col < 4 ? col_end - col : 4;
+        for (int k = 0; k < n; k++) out_row[col + k] = counts[k];
+        if (keep)
+            orbit_put(task, (size_t)row * task->width + col, 1, n, st[0], st[1], st[2], st[3]);
+    }
+}
+
+static void column_neon(const WorkerTask *task, int col, int row_start, int row_end) {
+    const float64x2_t vdy = vdupq_n_f64(task->dy);
+    const float64x2_t vpx = vdupq_n_f64((task->gx0 + col) * task->dx);
+    const float64x2_t px[2] = { vpx, vpx };
+    IterCount *out = task->output + col;
+    int counts[4];
+    double st[4][4], (*keep)[4] = task->orbits ? st : NULL;
+    
+    int last = row_end - 1;
+    for (int row = row_start; row < row_end; row += 4) {
+        double lo[2] = { task->gy0 - row, task->gy0 - TAIL_LANE(row, 1, last) };
+        double hi[2] = { task->gy0 - TAIL_LANE(row, 2, last),
+                         task->gy0 - TAIL_LANE(row, 3, last) };
+        float64x2_t py[2] = { vmulq_f64(vld1q_f64(lo), vdy), vmulq_f64(vld1q_f64(hi), vdy) };
+        escape_neon(task, px, py, counts, keep);
+        int n = row_end - row < 4 ? row_end - row : 4;
+        for (int k = 0; k < n; k++)
+            out[(row + k) * task->width] = counts[k];
+        if (keep)
+            orbit_put(task, (size_t)row * task->width + col, task->width, n,
+                      st[0], st[1], st[2], st[3]);
+    }
+}
+
+/* NEON float: 8 pixels as two 4-lane vectors, matching escape_f32() */
+static inline void escape_neon_f32(const WorkerTask *task, const float32x4_t px[2],
+                                   const float32x4_t py[2], int counts[8], float st[4][8]) {
+    const float32x4_t four = vdupq_n_f32(4.0f);
+    const float32x4_t two = vdupq_n_f32(2.0f);
+    const uint32x4_t one = vdupq_n_u32(1);
+    const uint32x4_t vmax = vdupq_n_u32((uint32_t)task->max_iter);
+    const float32x4_t eps2 = vdupq_n_f32((float)task->period_eps2);
+    const int check = task->interior_check;
+    float32x4_t zr[2], zi[2], cr[2], ci[2], sr[2], si[2];
+    uint32x4_t active[2], count[2];
+    
+    for (int k = 0; k < 2; k++) {
+        if (task->julia_mode) {
+            zr[k] = px[k]; zi[k] = py[k];
+            cr[k] = vdupq_n_f32((float)task->julia_cr);
+            ci[k] = vdupq_n_f32((float)task->julia_ci);
+        } else {
+            zr[k] = vdupq_n_f32(0); zi[k] = vdupq_n_f32(0);
+            cr[k] = px[k]; ci[k] = py[k];
+        }
+        active[k] = vdupq_n_u32(~0U);
+        count[k] = vdupq_n_u32(0);
+        
+        if (check && !task->julia_mode) {
+            float32x4_t y2 = vmulq_f32(ci[k], ci[k]);
+            float32x4_t xq = vsubq_f32(cr[k], vdupq_n_f32(0.25f));
+            float32x4_t q = vaddq_f32(vmulq_f32(xq, xq), y2);
+            uint32x4_t inside = vcleq_f32(vmulq_f32(q, vaddq_f32(q, xq)),
+                                          vmulq_f32(vdupq_n_f32(0.25f), y2));
+            float32x4_t xb = vaddq_f32(cr[k], vdupq_n_f32(1.0f));
+            inside = vorrq_u32(inside, vcleq_f32(vaddq_f32(vmulq_f32(xb, xb), y2),
+                                                 vdupq_n_f32(0.0625f)));
+            count[k] = vbslq_u32(inside, vmax, count[k]);
+            active[k] = vbicq_u32(active[k], inside);
+        }
+        sr[k] = zr[k]; si[k] = zi[k];
+    }
+    
+    int period = 1, next_save = 1;
+    
+    for (int iter = 0; iter < task->max_iter; iter++) {
+        for (int k = 0; k < 2; k++) {
+            float32x4_t zr2 = vmulq_f32(zr[k], zr[k]);
+            float32x4_t zi2 = vmulq_f32(zi[k], zi[k]);
+            float32x4_t mag = vaddq_f32(zr2, zi2);
+            active[k] = vbicq_u32(active[k], vcgtq_f32(mag, four));
+            count[k] = vaddq_u32(count[k], vandq_u32(active[k], one));
+            zi[k] = vaddq_f32(vmulq_f32(vmulq_f32(two, zr[k]), zi[k]), ci[k]);
+            zr[k] = vaddq_f32(vsubq_f32(zr2, zi2), cr[k]);
+            
+            if (check) {
+                float32x4_t er = vsubq_f32(zr[k], sr[k]), ei = vsubq_f32(zi[k], si[k]);
+                float32x4_t d2 = vaddq_f32(vmulq_f32(er, er), vmulq_f32(ei, ei));
+                uint32x4_t cyc = vandq_u32(active[k], vcltq_f32(d2, eps2));
+                count[k] = vbslq_u32(cyc, vmax, count[k]);
+                active[k] = vbicq_u32(active[k], cyc);
+            }
+        }
+        if (check && iter + 1 == next_save) {
+            for (int k = 0; k < 2; k++) { sr[k] = zr[k]; si[k] = zi[k]; }
+            period *= 2;
+            next_save += period;
+        }
+        if (vmaxvq_u32(vorrq_u32(active[0], active[1])) == 0)
+            break;
+    }
+    
+    for (int k = 0; k < 2; k++) {
+        uint32_t c[4];
+        vst1q_u32(c, count[k]);
+        for (int j = 0; j < 4; j++) counts[4 * k + j] = (int)c[j];
+        if (st) {
+            vst1q_f32(st[0] + 4 * k, vbslq_f32(active[k], zr[k], vdupq_n_f32(NAN)));
+            vst1q_f32(st[1] + 4 * k, zi[k]);
+            vst1q_f32(st[2] + 4 * k, sr[k]);
+            vst1q_f32(st[3] + 4 * k, si[k]);
+        }
+    }
+}
+
+static void span_neon_f32(const WorkerTask *task, int row,
+                          int col_start, int col_end, IterCount *out_row) {
+    const float32x4_t vpy = vdupq_n_f32((float)((task->gy0 - row) * task->dy));
+    const float32x4_t py[2] = { vpy, vpy };
+    
+    int counts[8], last = col_end - 1;
+    float st[4][8], (*keep)[8] = task->orbits ? st : NULL;
+    
+    for (int col = col_start; col < col_end; col += 8) {
+        float x[8];
+        for (int k = 0; k < 8; k++)
+            x[k] = (float)((task->gx0 + TAIL_LANE(col, k, last)) * task->dx);
+        float32x4_t px[2] = { vld1q_f32(x), vld1q_f32(x + 4) };
+        escape_neon_f32(task, px, py, counts, keep);
+        int n = col_end - col < 8 ? col_end - col : 8;
+        for (int k = 0; k < n; k++) out_row[col + k] = counts[k];
+        if (keep)
+            orbit_put_f32(task, (size_t)row * task->width + col, 1, n, st[0], st[1], st[2], st[3]);
+    }
+}
+
+static void column_neon_f32(const WorkerTask *task, int col, int row_start, int row_end) {
+    const float32x4_t vpx = vdupq_n_f32((float)((task->gx0 + col) * task->dx));
+    const float32x4_t px[2] = { vpx, vpx };
+    IterCount *out = task->output + col;
+    int counts[8];
+    float st[4][8], (*keep)[8] = task->orbits ? st : NULL;
+    
+    int last = row_end - 1;
+    for (int row = row_start; row < row_end; row += 8) {
+        float y[8];
+        for (int k = 0; k < 8; k++)
+            y[k] = (float)((task->gy0 - TAIL_LANE(row, k, last)) * task->dy);
+        float32x4_t py[2] = { vld1q_f32(y), vld1q_f32(y + 4) };
+        escape_neon_f32(task, px, py, counts, keep);
+        int n = row_end - row < 8 ? row_end - row : 8;
+        for (int k = 0; k < n; k++)
+            out[(row + k) * task->width] = counts[k];
+        if (keep)
+            orbit_put_f32(task, (size_t)row * task->width + col, task->width, n,
+                          st[0], st[1], st[2], st[3]);
+    }
+}
+
+#endif /* aarch64 */
+
+typedef struct {
+    const char *name;
+    SpanKernel fn;
+    ColumnKernel col_fn;
+    int lanes;
+    SpanKernel fn32;              /* Float tier versions */
+    ColumnKernel col32;
+    int lanes32;
+} KernelInfo;
+
+/* Ordered from most to least preferred; scalar is always last */
+static const KernelInfo kernels[] = {
+#if defined(__x86_64__) || defined(__i386__)
+    { "avx512", span_avx512, column_avx512, 8, span_avx512_f32, column_avx512_f32, 16 },
+    { "avx2",   span_avx2,   column_avx2,   4, span_avx2_f32,   column_avx2_f32,   8 },
+#endif
+#if defined(__aarch64__)
+    { "neon",   span_neon,   column_neon,   4, span_neon_f32,   column_neon_f32,   8 },
+#endif
+    { "scalar", span_scalar, column_scalar, 1, span_scalar_f32, column_scalar_f32, 1 },
+};
+#define KERNEL_COUNT (sizeof(kernels) / sizeof(kernels[0]))
+
+static const KernelInfo *active_kernel = &kernels[KERNEL_COUNT - 1];
+
+static int kernel_supported(const KernelInfo *k) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (k->fn == span_avx512) return __builtin_cpu_supports("avx512f");
+    if (k->fn == span_avx2) return __builtin_cpu_supports("avx2");
+#endif
+    (void)k;
+    return 1;
+}
+
+/*
+ * Pick the escape-time kernel. "auto" (or NULL) selects the widest one the
+ * CPU supports. Returns -1 if the named kernel is unknown or unsupported.
+ */
+static int select_kernel(const char *name) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+#endif
+    int want_auto = (!name || !strcmp(name, "auto"));
+    for (int i = 0; i < (int)KERNEL_COUNT; i++) {
+        if (!want_auto && strcmp(kernels[i].name, name)) continue;
+        if (!kernel_supported(&kernels[i])) {
+            if (want_auto) continue;
+            return -1;
+        }
+        active_kernel = &kernels[i];
+        return 0;
+    }
+    return -1;
+}
+
+/* Pixel grid the viewport was last snapped to */
+static double grid_dx, grid_dy;          /* Pixel spacing */
+static double grid_gx0, grid_gy0;        /* Grid index of left column / top row */
+
+#define GRID_SPACING_TOL 1e-9            /* Relative change still treated as same zoom */
+#define GRID_LEVELS      16              /* Recent spacings a view can snap back to */
+
+static double level_dx[GRID_LEVELS], level_dy[GRID_LEVELS];
+static int level_next_x, level_next_y;
+
+/* The recent spacing p is a rounding error away from, else p itself (remembered) */
+static double match_level(double p, double *levels, int *next) {
+    for (int i = 0; i < GRID_LEVELS; i++)
+        if (fabs(p - levels[i]) <= GRID_SPACING_TOL * levels[i]) return levels[i];
+    levels[*next] = p;
+    *next = (*next + 1) % GRID_LEVELS;
+    return p;
+}
+
+/*
+ * Align the viewport to whole pixels of a grid with the current spacing.
+ * Pans change the width only by rounding, and zooming in and back out
+ * only multiplies by a factor and its inverse, so a recent spacing is kept
+ * bit-identical; together with index-based pixel coordinates this makes a
+ * pixel's value independent of where the viewport happens to start.
+ */
+static void snap_viewport_to_grid(int calc_width, int calc_height) {
+    double px = (view_xmax - view_xmin) / calc_width;
+    double py = (view_ymax - view_ymin) / calc_height;
+    
+    px = match_level(px, level_dx, &level_next_x);
+    py = match_level(py, level_dy, &level_next_y);
+    
+    double gx = floor(view_xmin / px);
+    double gy = floor(view_ymin / py);
+    
+    view_xmin = gx * px; view_xmax = (gx + calc_width) * px;
+    view_ymin = gy * py; view_ymax = (gy + calc_height) * py;
+    
+    grid_dx = px; grid_dy = py;
+    grid_gx0 = gx; grid_gy0 = gy + calc_height;
+}
+
+/*
+ * Deep zoom by perturbation. Past DEEP_SPACING a double can no longer
+ * place pixels apart, so the viewport becomes relative to a fixed-point
+ * origin (view_origin_re/im) and pixels are iterated as small deltas from
+ * one reference orbit Z computed at full precision:
+ *
+ *   z = Z + dz,  c = C + dc:   dz' = 2·Z·dz + dz² + dc
+ *
+ * dz and dc stay tiny and fit doubles easily. The first iterations are
+ * skipped with a cubic series dz ≈ A·dc + B·dc² + C·dc³ whose coefficients
+ * follow the reference orbit; it is trusted up to the last iteration at
+ * which probe points around the view edge still agree with their directly
+ * perturbed orbits.
+ *
+ * A pixel whose orbit passes closer to 0 than its delta is long (or which
+ * outlives an escaping reference) would glitch: the delta no longer
+ * describes it accurately. It is rebased instead, with z itself as the
+ * delta against the start of the reference orbit, Z = 0.
+ *
+ * Deep zoom is Mandelbrot-only; Julia views keep plain doubles.
+ */
+#define DEEP_SPACING      1e-12     /* Use perturbation below this pixel spacing */
+#define DEEP_MIN_SPACING  1e-150    /* Zoom limit: BIG_LIMBS precision minus guard bits */
+#define DEEP_REBASE       1048576.0 /* Move the origin when the view drifts this many pixels */
+#define SA_TOLERANCE      1e-12     /* Relative series error still accepted */
+#define SA_PROBES         8
+
+struct DeepOrbit {
+    double *zr, *zi;              /* Reference orbit Z_0 .. Z_last */
+    int capacity;
+    int last;                     /* Escaped at Z_last, or last == max_iter */
+    int max_iter;                 /* 0 = no valid orbit */
+    int gen;                      /* Bumped for every new orbit */
+    double ref_x, ref_y;          /* Reference point relative to the origin */
+    int skip;                     /* Iterations covered by the series */
+    double ar, ai, br, bi, cr, ci;    /* Series coefficients at skip */
+};
+
+static DeepOrbit deep_orbit;
+static int view_deep = 0;         /* Current view uses the origin and perturbation */
+
+/* Fold the origin back into the double viewport */
+static void clear_view_origin(void) {
+    double ox = big_to_double(&view_origin_re), oy = big_to_double(&view_origin_im);
+    view_xmin += ox; view_xmax += ox;
+    view_ymin += oy; view_ymax += oy;
+    memset(&view_origin_re, 0, sizeof(view_origin_re));
+    memset(&view_origin_im, 0, sizeof(view_origin_im));
+    deep_orbit.max_iter = 0;
+}
+
+/*
+ * Decide whether the view needs perturbation and keep the double viewport
+ * small relative to the origin, moving the origin to the view center when
+ * the view has drifted far from it. Runs before the grid is snapped.
+ */
+static void update_view_origin(int calc_width, int calc_height) {
+    double px = (view_xmax - view_xmin) / calc_width;
+    double py = (view_ymax - view_ymin) / calc_height;
+    double cx = (view_xmin + view_xmax) / 2;
+    double cy = (view_ymin + view_ymax) / 2;
+    
+    view_deep = !julia_mode && px < DEEP_SPACING;
+    
+    if (!view_deep) {
+        if (!big_is_zero(&view_origin_re) || !big_is_zero(&view_origin_im))
+            clear_view_origin();
+    } else if (fabs(cx) > DEEP_REBASE * px || fabs(cy) > DEEP_REBASE * py) {
+        BigFix t;
+        big_from_double(&t, cx);
+        big_add(&view_origin_re, &view_origin_re, &t);
+        big_from_double(&t, cy);
+        big_add(&view_origin_im, &view_origin_im, &t);
+        view_xmin -= cx; view_xmax -= cx;
+        view_ymin -= cy; view_ymax -= cy;
+        deep_orbit.max_iter = 0;
+    }
+}
+
+/* Iterate the reference point origin + (ref_x, ref_y) at full precision */
+static int deep_reference(DeepOrbit *o, double ref_x, double ref_y, int max_n) {
+    if (o->capacity < max_n + 1) {
+        double *zr = realloc(o->zr, (size_t)(max_n + 1) * sizeof(double));
+        if (!zr) return -1;
+        o->zr = zr;
+        double *zi = realloc(o->zi, (size_t)(max_n + 1) * sizeof(double));
+        if (!zi) return -1;
+        o->zi = zi;
+        o->capacity = max_n + 1;
+    }
+    
+    BigFix cr, ci, zr = {0}, zi = {0}, zr2, zi2, t;
+    big_from_double(&t, ref_x);
+    big_add(&cr, &view_origin_re, &t);
+    big_from_double(&t, ref_y);
+    big_add(&ci, &view_origin_im, &t);
+    
+    int n = 0;
+    o->zr[0] = o->zi[0] = 0;
+    while (n < max_n) {
+        big_mul(&zr2, &zr, &zr);
+        big_mul(&zi2, &zi, &zi);
+        big_mul(&t, &zr, &zi);
+        big_add(&t, &t, &t);
+        big_add(&zi, &t, &ci);
+        big_sub(&zr, &zr2, &zi2);
+        big_add(&zr, &zr, &cr);
+        n++;
+        o->zr[n] = big_to_double(&zr);
+        o->zi[n] = big_to_double(&zi);
+        if (o->zr[n] * o->zr[n] + o->zi[n] * o->zi[n] > 4.0) break;
+    }
+    
+    o->last = n;
+    o->max_iter = max_n;
+    o->ref_x = ref_x; o->ref_y = ref_y;
+    o->gen++;
+    return 0;
+}
+
+/*
+ * Find how many iterations the series can skip for the task's view: step
+ * the coefficients and SA_PROBES edge points along the reference orbit and
+ * stop before the first iteration where a probe disagrees with the series,
+ * escapes, or would need rebasing.
+ */
+static void deep_series(DeepOrbit *o, const WorkerTask *task) {
+    double x0 = task->gx0 * task->dx - o->ref_x;
+    double x1 = (task->gx0 + task->width - 1) * task->dx - o->ref_x;
+    double y0 = (task->gy0 - task->height + 1) * task->dy - o->ref_y;
+    double y1 = task->gy0 * task->dy - o->ref_y;
+    const double pcr[SA_PROBES] = { x0, x1, x0, x1, x0, x1, (x0 + x1) / 2, (x0 + x1) / 2 };
+    const double pci[SA_PROBES] = { y0, y0, y1, y1, (y0 + y1) / 2, (y0 + y1) / 2, y0, y1 };
+    double dzr[SA_PROBES] = {0}, dzi[SA_PROBES] = {0};
+    double ar = 0, ai = 0, br = 0, bi = 0, cr = 0, ci = 0;
+    int limit = o->last < task->max_iter ? o->last : task->max_iter;
+    
+    o->skip = 0;
+    o->ar = o->ai = o->br = o->bi = o->cr = o->ci = 0;
+    
+    for (int n = 0; n < limit; n++) {
+        double Zr = o->zr[n], Zi = o->zi[n];
+        
+        for (int p = 0; p < SA_PROBES; p++) {
+            double zr = Zr + dzr[p], zi = Zi + dzi[p];
+            double mag = zr * zr + zi * zi;
+            double d2 = dzr[p] * dzr[p] + dzi[p] * dzi[p];
+            if (!(mag <= 4.0) || mag < d2) return;
+            
+            double tr = br + (pcr[p] * cr - pci[p] * ci);
+            double ti = bi + (pcr[p] * ci + pci[p] * cr);
+            double ur = ar + (pcr[p] * tr - pci[p] * ti);
+            double ui = ai + (pcr[p] * ti + pci[p] * tr);
+            double er = pcr[p] * ur - pci[p] * ui - dzr[p];
+            double ei = pcr[p] * ui + pci[p] * ur - dzi[p];
+            if (!(er * er + ei * ei <= SA_TOLERANCE * SA_TOLERANCE * d2)) return;
+        }
+        
+        o->skip = n;
+        o->ar = ar; o->ai = ai; o->br = br; o->bi = bi; o->cr = cr; o->ci = ci;
+        
+        /* A' = 2ZA + 1,  B' = 2ZB + A²,  C' = 2ZC + 2AB */
+        double nar = 2 * (Zr * ar - Zi * ai) + 1;
+        double nai = 2 * (Zr * ai + Zi * ar);
+        double nbr = 2 * (Zr * br - Zi * bi) + (ar * ar - ai * ai);
+        double nbi = 2 * (Zr * bi + Zi * br) + 2 * ar * ai;
+        double ncr = 2 * (Zr * cr - Zi * ci) + 2 * (ar * br - ai * bi);
+        double nci = 2 * (Zr * ci + Zi * cr) + 2 * (ar * bi + ai * br);
+        ar = nar; ai = nai; br = nbr; bi = nbi; cr = ncr; ci = nci;
+        
+        for (int p = 0; p < SA_PROBES; p++) {
+            double fr = 2 * Zr + dzr[p], fi = 2 * Zi + dzi[p];
+            double nr = fr * dzr[p] - fi * dzi[p] + pcr[p];
+            dzi[p] = fr * dzi[p] + fi * dzr[p] + pci[p];
+            dzr[p] = nr;
+        }
+    }
+}
+
+/*
+ * Attach the reference orbit to a deep task. The orbit is kept while the
+ * origin and max_iter stay the same and its point is still in view, so
+ * pans and zooms around one spot share it; the series is redone per view.
+ * Returns -1 if the orbit could not be allocated.
+ */
+static int setup_deep(WorkerTask *task) {
+    DeepOrbit *o = &deep_orbit;
+    task->deep = NULL;
+    task->deep_gen = 0;
+    if (!view_deep) return 0;
+    
+    /*
+     * A reference still in view is kept, and only extended or cut when the
+     * depth changes: the orbit up to the old depth stays the same, so kept
+     * pixel orbits remain valid against it.
+     */
+    int in_view = o->max_iter &&
+                  o->ref_x >= view_xmin && o->ref_x <= view_xmax &&
+                  o->ref_y >= view_ymin && o->ref_y <= view_ymax;
+    if (!in_view || o->max_iter != task->max_iter) {
+        double rx = in_view ? o->ref_x : (task->gx0 + task->width / 2) * task->dx;
+        double ry = in_view ? o->ref_y : (task->gy0 - task->height / 2) * task->dy;
+        if (deep_reference(o, rx, ry, task->max_iter) != 0) return -1;
+    }
+    deep_series(o, task);
+    
+    task->deep = o;
+    task->deep_gen = o->gen;
+    task->interior_check = 0;     /* Closed-form tests need absolute coordinates */
+    return 0;
+}
+
+/*
+ * Perturbed orbit from iteration n, with dz = st->zr/zi against reference
+ * index m = st->sr. On reaching max_n, st holds where the orbit stopped.
+ */
+static inline int iterate_deep(const DeepOrbit *o, OrbitPoint *st, int n, int max_n,
+                               double dcr, double dci) {
+    const double *Zr = o->zr, *Zi = o->zi;
+    double dzr = st->zr, dzi = st->zi;
+    int m = (int)st->sr;
+    
+    for (int iter = n; iter < max_n; iter++) {
+        double zr = Zr[m] + dzr, zi = Zi[m] + dzi;
+        double mag = zr * zr + zi * zi;
+        if (mag > 4.0) return iter;
+        if (mag < dzr * dzr + dzi * dzi || m == o->last) {
+            dzr = zr; dzi = zi;   /* Rebase onto Z_0 = 0 */
+            m = 0;
+        }
+        double fr = 2 * Zr[m] + dzr, fi = 2 * Zi[m] + dzi;
+        double nr = fr * dzr - fi * dzi + dcr;
+        dzi = fr * dzi + fi * dzr + dci;
+        dzr = nr;
+        m++;
+    }
+    *st = (OrbitPoint){ dzr, dzi, m, 0 };
+    return max_n;
+}
+
+static inline int escape_deep(const DeepOrbit *o, int max_n, double dcr, double dci,
+                              OrbitPoint *st) {
+    /* dz = dc·(A + dc·(B + dc·C)) */
+    double tr = o->br + (dcr * o->cr - dci * o->ci);
+    double ti = o->bi + (dcr * o->ci + dci * o->cr);
+    double ur = o->ar + (dcr * tr - dci * ti);
+    double ui = o->ai + (dcr * ti + dci * tr);
+    OrbitPoint tmp, *orbit = st ? st : &tmp;
+    *orbit = (OrbitPoint){ dcr * ur - dci * ui, dcr * ui + dci * ur, o->skip, 0 };
+    return iterate_deep(o, orbit, o->skip, max_n, dcr, dci);
+}
+
+static void span_deep(const WorkerTask *task, int row,
+                      int col_start, int col_end, IterCount *out_row) {
+    const DeepOrbit *o = task->deep;
+    double dci = (task->gy0 - row) * task->dy - o->ref_y;
+    for (int col = col_start; col < col_end; col++)
+        out_row[col] = escape_deep(o, task->max_iter,
+                                   (task->gx0 + col) * task->dx - o->ref_x, dci,
+                                   orbit_at(task, col, row));
+}
+
+static void column_deep(const WorkerTask *task, int col, int row_start, int row_end) {
+    const DeepOrbit *o = task->deep;
+    double dcr = (task->gx0 + col) * task->dx - o->ref_x;
+    for (int row = row_start; row < row_end; row++)
+        task->output[row * task->width + col] =
+            escape_deep(o, task->max_iter, dcr, (task->gy0 - row) * task->dy - o->ref_y,
+                        orbit_at(task, col, row));
+}
+
+/*
+ * Work-stealing deque over a contiguous range of tile indices. Tiles are
+ * only ever removed, so head and tail are packed into one word: the owner
+ * takes from the head, thieves from the tail, both with a single CAS.
+ */
+typedef struct {
+    _Alignas(64) _Atomic uint64_t range;   /* tail << 32 | head */
+} TileDeque;
+
+static inline uint64_t deque_pack(uint32_t head, uint32_t tail) {
+    return ((uint64_t)tail << 32) | head;
+}
+
+static int deque_take(TileDeque *d, int from_tail, int *index) {
+    uint64_t r = atomic_load(&d->range);
+    for (;;) {
+        uint32_t head = (uint32_t)r, tail = (uint32_t)(r >> 32);
+        if (head >= tail) return 0;
+        uint64_t next = from_tail ? deque_pack(head, tail - 1) : deque_pack(head + 1, tail);
+        if (atomic_compare_exchange_weak(&d->range, &r, next)) {
+            *index = (int)(from_tail ? tail - 1 : head);
+            return 1;
+        }
+    }
+}
+
+#define MAX_JOB_RECTS 512
+
+/*
+ * One frame computation over up to MAX_JOB_RECTS rectangles of the buffer
+ * (the whole image, or the strips a pan exposed). Each rectangle is cut
+ * into tile_w x tile_h tiles, numbered row-major and then rectangle by
+ * rectangle. Depending on the scheduler, workers either process a fixed
+ * row band of every rectangle (static), claim tiles from a shared counter
+ * (dynamic), or drain their own deque of neighbouring tiles and then steal
+ * (steal).
+ *
+ * Workers check the cancel flag between rows and before claiming a tile,
+ * so a stale frame is abandoned within one row of work.
+ *
+ * A progressive pass computes only every stride'th row and column. The
+ * coarse (first) pass takes all points of that grid; later passes skip the
+ * points the previous pass, at twice the stride, already has.
+ *
+ * With solid_guess, full-resolution work goes through the Mariani-Silver
+ * engine (ms_rect) instead of the per-pixel loop, one tile at a time.
+ *
+ * With resume_from set, the buffer already holds the previous frame and
+ * only its pixels at that depth are continued (resume_rect).
+ */
+typedef struct {
+    WorkerTask task;
+    int stride, coarse;           /* 1, 1 = every pixel */
+    int solid_guess;
+    int resume_from;              /* Continue pixels stopped at this depth, 0 = off */
+    const OrbitPoint *resume_orbits;  /* Where they stopped */
+    SpanKernel span;              /* active_kernel in the task's tier, or perturbation */
+    ColumnKernel column;
+    SchedMode sched;
+    int workers;
+    int tile_w, tile_h;
+    Rect rects[MAX_JOB_RECTS];
+    int rect_tiles_x[MAX_JOB_RECTS];
+    int rect_first_tile[MAX_JOB_RECTS + 1];
+    int rect_count, tile_count;
+    Rect mirror;                  /* Copied from its mirror image when done, see plan_mirror */
+    atomic_int next_tile;
+    atomic_int cancel;            /* Set by the input thread for stale frames */
+    PoolJobFn compute;            /* Where it runs (see prepare_frame_job) */
+    double start_ms;              /* When setup of this pass began */
+    double busy_ms[MAX_THREADS];  /* Time each worker spent on the last run */
+    double iterations[MAX_THREADS];  /* Sum of the counts each worker computed */
+    TileDeque deques[MAX_THREADS];
+} FrameJob;
+
+static FrameJob frame_job;
+
+/*
+ * A compute backend fills the rectangles of prepared frame jobs. The CPU
+ * backend is the pool running compute_job(); the others (see COMPUTE
+ * BACKENDS) accept only the jobs they can compute exactly as the CPU
+ * would, and the pool keeps the rest.
+ */
+typedef struct {
+    const char *name;
+    int optional;                 /* Fall back to the CPU if init fails */
+    int (*init)(void);            /* 0 if usable */
+    void (*close)(void);
+    int (*fp64)(void);            /* Computes in double precision */
+    int (*accepts)(const FrameJob *job);
+    PoolJobFn compute;            /* Pool job that fills job->task.output */
+} Backend;
+
+static const Backend *active_backend;
+
+static void job_add_rect(FrameJob *job, int x0, int y0, int x1, int y1) {
+    if (x0 >= x1 || y0 >= y1 || job->rect_count == MAX_JOB_RECTS) return;
+    int n = job->rect_count++;
+    job->rects[n] = (Rect){ x0, y0, x1, y1 };
+}
+
+/*
+ * Mariani-Silver solid guessing. The border of [x0, x1) x [y0, y1) is
+ * already computed. If every border pixel has the same count, the interior
+ * is flooded with it; escape-time level sets (and the set itself) are
+ * connected, so a uniform border almost always means a uniform inside.
+ * Otherwise the rectangle is split across its longer side, the splitting
+ * line is computed, and both halves recurse. Small rectangles are simply
+ * computed pixel by pixel.
+ */
+static void ms_fill(const FrameJob *job, int x0, int y0, int x1, int y1) {
+    const WorkerTask *task = &job->task;
+    int w = task->width;
+    IterCount *buf = task->output;
+    if (x1 - x0 <= 2 || y1 - y0 <= 2) return;   /* No interior */
+    
+    int v = buf[y0 * w + x0], uniform = 1;
+    for (int x = x0; x < x1 && uniform; x++)
+        uniform = (buf[y0 * w + x] == v && buf[(y1 - 1) * w + x] == v);
+    for (int y = y0 + 1; y < y1 - 1 && uniform; y++)
+        uniform = (buf[y * w + x0] == v && buf[y * w + x1 - 1] == v);
+    
+    if (uniform) {
+        for (int y = y0 + 1; y < y1 - 1; y++)
+            for (int x = x0 + 1; x < x1 - 1; x++)
+                buf[y * w + x] = v;
+        return;
+    }
+    
+    if (x1 - x0 <= MS_MIN_SIZE || y1 - y0 <= MS_MIN_SIZE) {
+        /* Run along the longer side so vector kernels get full lanes */
+        if (x1 - x0 >= y1 - y0) {
+            for (int y = y0 + 1; y < y1 - 1; y++)
+                job->span(task, y, x0 + 1, x1 - 1, buf + y * w);
+        } else {
+            for (int x = x0 + 1; x < x1 - 1; x++)
+                job->column(task, x, y0 + 1, y1 - 1);
+        }
+        return;
+    }
+    
+    if (x1 - x0 >= y1 - y0) {
+        int mid = (x0 + x1) / 2;
+        job->column(task, mid, y0 + 1, y1 - 1);
+        ms_fill(job, x0, y0, mid + 1, y1);
+        ms_fill(job, mid, y0, x1, y1);
+    } else {
+        int mid = (y0 + y1) / 2;
+        job->span(task, mid, x0 + 1, x1 - 1, buf + mid * w);
+        ms_fill(job, x0, y0, x1, mid + 1);
+        ms_fill(job, x0, mid, x1, y1);
+    }
+}
+
+static void ms_rect(const FrameJob *job, int x0, int y0, int x1, int y1) {
+    const WorkerTask *task = &job->task;
+    int w = task->width;
+    IterCount *buf = task->output;
+    
+    job->span(task, y0, x0, x1, buf + y0 * w);
+    if (y1 - 1 > y0) job->span(task, y1 - 1, x0, x1, buf + (y1 - 1) * w);
+    job->column(task, x0, y0 + 1, y1 - 1);
+    if (x1 - 1 > x0) job->column(task, x1 - 1, y0 + 1, y1 - 1);
+    ms_fill(job, x0, y0, x1, y1);
+}
+
+/*
+ * Carry the pixels that stopped at resume_from on to max_iter, from the
+ * orbits the previous frame kept. Proven interior points just take the
+ * new depth; points without a kept orbit start over.
+ */
+static void resume_rect(const FrameJob *job, int x0, int y0, int x1, int y1) {
+    const WorkerTask *task = &job->task;
+    const DeepOrbit *o = task->deep;
+    int from = job->resume_from, max_n = task->max_iter;
+    
+    for (int row = y0; row < y1; row++) {
+        if (atomic_load_explicit(&job->cancel, memory_order_relaxed)) return;
+        double py = (task->gy0 - row) * task->dy;
+        for (int col = x0; col < x1; col++) {
+            size_t i = (size_t)row * task->width + col;
+            if (task->output[i] < from) continue;
+            
+            OrbitPoint orbit = job->resume_orbits[i];
+            double px = (task->gx0 + col) * task->dx;
+            int n;
+            if (ORBIT_INTERIOR(&orbit)) {
+                n = max_n;
+            } else if (ORBIT_UNKNOWN(&orbit)) {
+                n = o ? escape_deep(o, max_n, px - o->ref_x, py - o->ref_y, &orbit)
+                  : task->precision == PREC_FLOAT ? escape_f32(task, px, py, &orbit)
+                  : escape_scalar(task, px, py, &orbit);
+            } else if (o) {
+                n = iterate_deep(o, &orbit, from, max_n, px - o->ref_x, py - o->ref_y);
+            } else if (task->precision == PREC_FLOAT) {
+                double cr, ci;
+                pixel_c(task, px, py, &cr, &ci);
+                float eps2 = (float)task->period_eps2;
+                n = task->interior_check
+                  ? iterate_periodic_f32(&orbit, (float)cr, (float)ci, from, max_n, eps2)
+                  : iterate_plain_f32(&orbit, (float)cr, (float)ci, from, max_n);
+            } else {
+                double cr, ci;
+                pixel_c(task, px, py, &cr, &ci);
+                n = task->interior_check
+                  ? iterate_periodic(&orbit, cr, ci, from, max_n, task->period_eps2)
+                  : iterate_plain(&orbit, cr, ci, from, max_n);
+            }
+            task->output[i] = (IterCount)n;
+            task->orbits[i] = orbit;
+        }
+    }
+}
+
+/*
+ * Compute the job's pixels in a rectangle. Returns the sum of the counts
+ * it computed, for the frame budget's cost model; resumed pixels, whose
+ * earlier iterations are not repeated, count as 0.
+ */
+static double compute_rect(const FrameJob *job, int x0, int y0, int x1, int y1) {
+    const WorkerTask *task = &job->task;
+    int s = job->stride;
+    double sum = 0;
+    
+    if (job->resume_from) {
+        resume_rect(job, x0, y0, x1, y1);
+        return 0;
+    }
+    
+    if (job->solid_guess && s == 1 && job->coarse) {
+        if (atomic_load_explicit(&job->cancel, memory_order_relaxed)) return 0;
+        ms_rect(job, x0, y0, x1, y1);
+        for (int row = y0; row < y1; row++)
+            for (int col = x0; col < x1; col++) sum += task->output[row * task->width + col];
+        return sum;
+    }
+    
+    for (int row = y0; row < y1; row++) {
+        if (row % s) continue;
+        if (atomic_load_explicit(&job->cancel, memory_order_relaxed)) break;
+        IterCount *out_row = task->output + row * task->width;
+        int step = s, col = (x0 + s - 1) / s * s;
+        if (!job->coarse && row % (2 * s) == 0) {
+            step = 2 * s;
+            col = x0 + (s - x0 % step + step) % step;
+        }
+        if (step == 1) {
+            job->span(task, row, x0, x1, out_row);
+            uint64_t row_sum = 0;
+            for (col = x0; col < x1; col++) row_sum += out_row[col];
+            sum += row_sum;
+        } else {
+            for (; col < x1; col += step) {
+                job->span(task, row, col, col + 1, out_row);
+                sum += out_row[col];
+            }
+        }
+    }
+    return sum;
+}
+
+static double calculate_tile(const FrameJob *job, int index) {
+    int n = 0, hi = job->rect_count - 1;
+    while (n < hi) {
+        int mid = (n + hi + 1) / 2;
+        if (job->rect_first_tile[mid] <= index) n = mid; else hi = mid - 1;
+    }
+    index -= job->rect_first_tile[n];
+    
+    const Rect *r = &job->rects[n];
+    int x0 = r->x0 + (index % job->rect_tiles_x[n]) * job->tile_w;
+    int y0 = r->y0 + (index / job->rect_tiles_x[n]) * job->tile_h;
+    int x1 = x0 + job->tile_w < r->x1 ? x0 + job->tile_w : r->x1;
+    int y1 = y0 + job->tile_h < r->y1 ? y0 + job->tile_h : r->y1;
+    
+    return compute_rect(job, x0, y0, x1, y1);
+}
+
+static void compute_job(void *ctx, int worker_id) {
+    FrameJob *job = ctx;
+    double start = now_ms(), sum = 0;
+    int index;
+    
+    switch (job->sched) {
+    case SCHED_STATIC:
+        for (int n = 0; n < job->rect_count; n++) {
+            const Rect *r = &job->rects[n];
+            int h = r->y1 - r->y0;
+            int bands = job->workers > h ? h : job->workers;
+            if (worker_id >= bands) continue;
+            int rows_each = h / bands, extra_rows = h % bands;
+            int start = r->y0 + worker_id * rows_each +
+                        (worker_id < extra_rows ? worker_id : extra_rows);
+            sum += compute_rect(job, r->x0, start, r->x1,
+                                start + rows_each + (worker_id < extra_rows));
+        }
+        break;
+    case SCHED_DYNAMIC:
+        while (!atomic_load_explicit(&job->cancel, memory_order_relaxed) &&
+               (index = atomic_fetch_add(&job->next_tile, 1)) < job->tile_count)
+            sum += calculate_tile(job, index);
+        break;
+    case SCHED_STEAL:
+        while (!atomic_load_explicit(&job->cancel, memory_order_relaxed) &&
+               deque_take(&job->deques[worker_id], 0, &index))
+            sum += calculate_tile(job, index);
+        for (int k = 1; k < job->workers; k++) {
+            TileDeque *victim = &job->deques[(worker_id + k) % job->workers];
+            while (!atomic_load_explicit(&job->cancel, memory_order_relaxed) &&
+                   deque_take(victim, 1, &index))
+                sum += calculate_tile(job, index);
+        }
+        break;
+    }
+    job->busy_ms[worker_id] = now_ms() - start;
+    job->iterations[worker_id] = sum;
+}
+
+/* Number the tiles of the job's rectangles and seed the scheduler */
+static void prepare_frame_job(FrameJob *job) {
+    job->sched = sched_mode;
+    job->workers = pool_size();
+    job->solid_guess = solid_guess;
+    if (job->task.deep) {
+        job->span = span_deep;
+        job->column = column_deep;
+    } else if (job->task.precision == PREC_FLOAT) {
+        job->span = active_kernel->fn32;
+        job->column = active_kernel->col32;
+    } else if (job->task.precision == PREC_LONG) {
+        job->span = span_long;
+        job->column = column_long;
+    } else {
+        job->span = active_kernel->fn;
+        job->column = active_kernel->col_fn;
+    }
+    int ms = (solid_guess && job->stride == 1 && job->coarse);
+    job->tile_w = ms ? MS_TILE_W : TILE_W;
+    job->tile_h = ms ? MS_TILE_H : TILE_H;
+    job->compute = active_backend->accepts(job) ? active_backend->compute : compute_job;
+    job->tile_count = 0;
+    for (int n = 0; n < job->rect_count; n++) {
+        const Rect *r = &job->rects[n];
+        job->rect_tiles_x[n] = (r->x1 - r->x0 + job->tile_w - 1) / job->tile_w;
+        job->rect_first_tile[n] = job->tile_count;
+        job->tile_count += job->rect_tiles_x[n] *
+                           ((r->y1 - r->y0 + job->tile_h - 1) / job->tile_h);
+    }
+    job->rect_first_tile[job->rect_count] = job->tile_count;
+    atomic_store(&job->next_tile, 0);
+    atomic_store(&job->cancel, 0);
+    
+    /* Seed each deque with a contiguous run of tiles */
+    int each = job->tile_count / job->workers, extra = job->tile_count % job->workers;
+    int first = 0;
+    for (int i = 0; i < job->workers; i++) {
+        int n = each + (i < extra ? 1 : 0);
+        atomic_store(&job->deques[i].range, deque_pack(first, first + n));
+        first += n;
+    }
+}
+
+/* Pool job for a prepared frame_job, on whichever backend took it */
+static void run_frame_job(void *ctx, int worker_id) {
+    ((FrameJob *)ctx)->compute(ctx, worker_id);
+}
+
+/* Everything except position, size and buffer matches, so pixels can be shared */
+static int same_pixel_spacing(const WorkerTask *a, const WorkerTask *b) {
+    return a->dx == b->dx && a->dy == b->dy &&
+           a->max_iter == b->max_iter &&
+           a->julia_mode == b->julia_mode &&
+           (!a->julia_mode || (a->julia_cr == b->julia_cr && a->julia_ci == b->julia_ci)) &&
+           a->interior_check == b->interior_check &&
+           a->precision == b->precision &&
+           a->deep_gen == b->deep_gen;
+}
+
+/* The same, with the same frame size */
+static int same_pixel_grid(const WorkerTask *a, const WorkerTask *b) {
+    return a->width == b->width && a->height == b->height && same_pixel_spacing(a, b);
+}
+
+/* Parameters of the last finished frame, i.e. the one on screen */
+static WorkerTask last_task;
+static double last_ref_x, last_ref_y;    /* Its deep reference point */
+static BigFix last_origin_re, last_origin_im;    /* and origin */
+
+/* a and b differ at most in depth, and the reference orbit that follows it */
+static int same_grid_but_depth(const WorkerTask *a, const WorkerTask *b) {
+    WorkerTask t = *b;
+    t.max_iter = a->max_iter;
+    t.deep_gen = a->deep_gen;
+    return (a->deep != NULL) == (b->deep != NULL) && same_pixel_grid(a, &t);
+}
+
+/* Stride of the last finished progressive pass; 1 once the frame is complete */
+static int refine_stride = 1;
+
+/*
+ * What the frame on screen cost, for the s overlay. Compute time and
+ * worker busy time add up over its progressive passes; the draw figures
+ * are those of the last render_frame(), and the totals are taken from the
+ * buffer when it is drawn.
+ */
+typedef struct {
+    double compute_ms;
+    double busy_ms[MAX_THREADS];
+    int workers;
+    double render_ms;
+    size_t bytes;
+    double iterations;            /* Sum of the escape counts */
+    double capped;                /* Fraction of pixels at max_iter */
+} FrameStats;
+
+static FrameStats frame_stats;
+static int show_stats = 0;
+
+/*
+ * Frame budget. Every finished pass updates a cost model: milliseconds per
+ * iteration (a running average, so it follows a host whose spare CPU
+ * changes from minute to minute), and how deep the view's pixels go as
+ * the mean count over max_iter. A full-resolution job that the model says
+ * would take longer than frame_budget_ms starts as a coarse pass at the
+ * smallest power-of-two stride that fits; the progressive passes then
+ * refine it, unless a key replaces the view first.
+ */
+static double budget_ms_per_iter;        /* 0 until a pass was timed */
+static double budget_depth = 1;          /* Mean count / max_iter of the last full pass */
+
+static double job_pixels(const FrameJob *job) {
+    double pixels = 0;
+    for (int n = 0; n < job->rect_count; n++) {
+        const Rect *r = &job->rects[n];
+        pixels += (double)(r->x1 - r->x0) * (r->y1 - r->y0);
+    }
+    return pixels;
+}
+
+static void budget_learn(const FrameJob *job, double ms) {
+    double sum = 0;
+    for (int i = 0; i < job->workers; i++) sum += job->iterations[i];
+    if (sum <= 0 || job->resume_from) return;
+    
+    double rate = ms / sum;
+    budget_ms_per_iter = budget_ms_per_iter > 0 ? (budget_ms_per_iter + rate) / 2 : rate;
+    if (job->stride == 1 && job->coarse)
+        budget_depth = sum / (job_pixels(job) * job->task.max_iter);
+}
+
+/* Stride for a first pass over pixels that fits the budget, 1 = full */
+static int budget_stride(const FrameJob *job, double pixels) {
+    double ms = budget_ms_per_iter * budget_depth * job->task.max_iter * pixels;
+    int s = 1;
+    while (s < PROGRESSIVE_STRIDE && ms / ((double)s * s) > frame_budget_ms) s *= 2;
+    return s;
+}
+
+/*
+ * Give every pixel of the job's rectangles that is off the stride grid
+ * the value of its block's sample. Samples outside a rectangle come from
+ * the part of the frame that was already complete.
+ */
+static void fill_blocks(const FrameJob *job, int s) {
+    IterCount *buf = job->task.output;
+    int w = job->task.width;
+    for (int n = 0; n < job->rect_count; n++) {
+        const Rect *r = &job->rects[n];
+        for (int row = r->y0; row < r->y1; row++) {
+            IterCount *dst = buf + row * w;
+            const IterCount *src = buf + (row - row % s) * w;
+            for (int col = r->x0; col < r->x1; col++)
+                if (row % s || col % s) dst[col] = src[col - col % s];
+        }
+    }
+}
+
+/*
+ * Tile cache. A pixel's count depends only on its grid index, the spacing
+ * and the iteration parameters, so a block of the global pixel grid can be
+ * reused by any later frame on the same grid: after reset_view(), zooming
+ * back out, or returning from Julia mode. Completed frames leave their
+ * whole CACHE_TILE_W x CACHE_TILE_H tiles here; a full recompute copies
+ * the tiles it finds and computes only the rest. The least recently used
+ * tiles are evicted once cache_mb is reached.
+ *
+ * Deep-zoom frames are not cached: their counts also depend on the
+ * reference orbit. Mariani-Silver guesses are kept apart from exact counts.
+ */
+typedef struct {
+    double dx, dy;
+    double julia_cr, julia_ci;    /* 0 outside Julia mode */
+    int64_t tx, ty;               /* Tile index on the grid */
+    int max_iter;
+    int julia_mode, interior_check, solid_guess;
+    Precision precision;
+} TileKey;
+
+typedef struct CacheTile {
+    TileKey key;
+    struct CacheTile *next;                /* Hash chain */
+    struct CacheTile *newer, *older;       /* LRU list */
+    IterCount data[CACHE_TILE_W * CACHE_TILE_H];
+} CacheTile;
+
+static struct {
+    CacheTile **buckets;
+    size_t mask;                  /* Bucket count - 1 */
+    size_t count, limit;          /* Tiles held / allowed */
+    CacheTile *newest, *oldest;
+} tile_cache;
+
+#define CACHE_MAX_GRID_INDEX 1e15 /* Grid indices beyond this are not cached */
+
+static void cache_init(void) {
+    tile_cache.limit = (size_t)cache_mb * 1024 * 1024 / sizeof(CacheTile);
+    if (tile_cache.limit == 0) return;
+    size_t n = 1;
+    while (n < tile_cache.limit) n *= 2;
+    tile_cache.buckets = calloc(n, sizeof(CacheTile *));
+    if (!tile_cache.buckets) {
+        tile_cache.limit = 0;
+        return;
+    }
+    tile_cache.mask = n - 1;
+}
+
+static void cache_free(void) {
+    CacheTile *t = tile_cache.newest;
+    while (t) {
+        CacheTile *older = t->older;
+        free(t);
+        t = older;
+    }
+    free(tile_cache.buckets);
+    memset(&tile_cache, 0, sizeof(tile_cache));
+}
+
+static inline uint64_t mix64(uint64_t h, uint64_t v) {
+    h ^= v + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+    return h;
+}
+
+static size_t tile_hash(const TileKey *k) {
+    uint64_t d[4];
+    memcpy(&d[0], &k->dx, 8); memcpy(&d[1], &k->dy, 8);
+    memcpy(&d[2], &k->julia_cr, 8); memcpy(&d[3], &k->julia_ci, 8);
+    uint64_t h = 0;
+    for (int i = 0; i < 4; i++) h = mix64(h, d[i]);
+    h = mix64(h, (uint64_t)k->tx);
+    h = mix64(h, (uint64_t)k->ty);
+    h = mix64(h, (uint64_t)k->max_iter << 5 | (uint64_t)k->precision << 3 |
+                 (uint64_t)k->julia_mode << 2 | (uint64_t)k->interior_check << 1 |
+                 (uint64_t)k->solid_guess);
+    h ^= h >> 33; h *= 0xFF51AFD7ED558CCDULL; h ^= h >> 33;
+    return (size_t)h;
+}
+
+static int tile_key_equal(const TileKey *a, const TileKey *b) {
+    return a->tx == b->tx && a->ty == b->ty &&
+           a->dx == b->dx && a->dy == b->dy &&
+           a->max_iter == b->max_iter && a->julia_mode == b->julia_mode &&
+           a->julia_cr == b->julia_cr && a->julia_ci == b->julia_ci &&
+           a->interior_check == b->interior_check && a->solid_guess == b->solid_guess &&
+           a->precision == b->precision;
+}
+
+static void lru_unlink(CacheTile *t) {
+    if (t->newer) t->newer->older = t->older; else tile_cache.newest = t->older;
+    if (t->older) t->older->newer = t->newer; else tile_cache.oldest = t->newer;
+}
+
+static void lru_push(CacheTile *t) {
+    t->newer = NULL;
+    t->older = tile_cache.newest;
+    if (tile_cache.newest) tile_cache.newest->newer = t; else tile_cache.oldest = t;
+    tile_cache.newest = t;
+}
+
+/* The cached tile for key, marked as most recently used; NULL on a miss */
+static CacheTile *cache_find(const TileKey *key) {
+    for (CacheTile *t = tile_cache.buckets[tile_hash(key) & tile_cache.mask]; t; t = t->next) {
+        if (!tile_key_equal(&t->key, key)) continue;
+        lru_unlink(t);
+        lru_push(t);
+        return t;
+    }
+    return NULL;
+}
+
+/* Insert the tile whose top-left pixel is src (row pitch w), evicting if full */
+static void cache_store(const TileKey *key, const IterCount *src, int w) {
+    if (cache_find(key)) return;
+    
+    CacheTile *t;
+    if (tile_cache.count == tile_cache.limit) {
+        t = tile_cache.oldest;
+        lru_unlink(t);
+        CacheTile **p = &tile_cache.buckets[tile_hash(&t->key) & tile_cache.mask];
+        while (*p != t) p = &(*p)->next;
+        *p = t->next;
+    } else {
+        t = malloc(sizeof(CacheTile));
+        if (!t) return;
+        tile_cache.count++;
+    }
+    
+    t->key = *key;
+    for (int i = 0; i < CACHE_TILE_H; i++)
+        memcpy(t->data + i * CACHE_TILE_W, src + i * w, CACHE_TILE_W * sizeof(IterCount));
+    CacheTile **head = &tile_cache.buckets[tile_hash(key) & tile_cache.mask];
+    t->next = *head;
+    *head = t;
+    lru_push(t);
+}
+
+/*
+ * Key of task's tiles, with tx/ty left to the caller, and the column and
+ * row of its first whole tile. Returns 0 if the frame cannot be cached.
+ */
+static int frame_tiles(const WorkerTask *task, TileKey *key, int *col0, int *row0) {
+    if (!tile_cache.limit || task->deep ||
+        fabs(task->gx0) > CACHE_MAX_GRID_INDEX || fabs(task->gy0) > CACHE_MAX_GRID_INDEX)
+        return 0;
+    
+    *key = (TileKey){
+        .dx = task->dx, .dy = task->dy,
+        .julia_cr = task->julia_mode ? task->julia_cr : 0,
+        .julia_ci = task->julia_mode ? task->julia_ci : 0,
+        .max_iter = task->max_iter,
+        .julia_mode = task->julia_mode,
+        .interior_check = task->interior_check,
+        .solid_guess = solid_guess,
+        .precision = task->precision
+    };
+    /* Column c is grid column gx0 + c; row r is grid row r - gy0 */
+    int64_t gx = (int64_t)task->gx0, gr = -(int64_t)task->gy0;
+    *col0 = (int)(((-gx) % CACHE_TILE_W + CACHE_TILE_W) % CACHE_TILE_W);
+    *row0 = (int)(((-gr) % CACHE_TILE_H + CACHE_TILE_H) % CACHE_TILE_H);
+    return 1;
+}
+
+static inline void tile_at(const WorkerTask *task, TileKey *key, int col, int row) {
+    key->tx = ((int64_t)task->gx0 + col) / CACHE_TILE_W;
+    key->ty = (row - (int64_t)task->gy0) / CACHE_TILE_H;
+}
+
+/* Put every whole tile of a finished frame into the cache */
+static void cache_store_frame(const WorkerTask *task) {
+    TileKey key;
+    int col0, row0;
+    if (!frame_tiles(task, &key, &col0, &row0)) return;
+    
+    for (int y = row0; y + CACHE_TILE_H <= task->height; y += CACHE_TILE_H)
+        for (int x = col0; x + CACHE_TILE_W <= task->width; x += CACHE_TILE_W) {
+            tile_at(task, &key, x, y);
+            cache_store(&key, task->output + y * task->width + x, task->width);
+        }
+}
+
+/*
+ * Copy the cached tiles of the frame into its buffer and add rectangles
+ * for the rest. Each band of tile rows contributes one rectangle per run
+ * of missing tiles; a band whose runs match the band above extends that
+ * band's rectangles instead, so an uncached frame stays one rectangle.
+ */
+static void cache_fill(FrameJob *job) {
+    const WorkerTask *task = &job->task;
+    int w = task->width, h = task->height;
+    TileKey key;
+    int col0, row0;
+    
+    if (!frame_tiles(task, &key, &col0, &row0)) {
+        job_add_rect(job, 0, 0, w, h);
+        return;
+    }
+    
+    int prev_first = 0, prev_count = -1;
+    for (int y = 0; y < h; ) {
+        int y1 = y < row0 ? row0 : y + CACHE_TILE_H;
+        if (y1 > h) y1 = h;
+        int whole = (y >= row0 && y1 - y == CACHE_TILE_H);
+        int first = job->rect_count, run = whole ? -1 : 0;
+        
+        for (int x = 0; whole && x < w; ) {
+            int x1 = x < col0 ? col0 : x + CACHE_TILE_W;
+            if (x1 > w) x1 = w;
+            CacheTile *t = NULL;
+            if (x >= col0 && x1 - x == CACHE_TILE_W) {
+                tile_at(task, &key, x, y);
+                t = cache_find(&key);
+            }
+            if (t) {
+                for (int i = 0; i < CACHE_TILE_H; i++)
+                    memcpy(task->output + (y + i) * w + x, t->data + i * CACHE_TILE_W,
+                           CACHE_TILE_W * sizeof(IterCount));
+                if (run >= 0) job_add_rect(job, run, y, x, y1);
+                run = -1;
+            } else if (run < 0) {
+                run = x;
+            }
+            x = x1;
+        }
+        if (run >= 0) job_add_rect(job, run, y, w, y1);
+        
+        if (job->rect_count == MAX_JOB_RECTS) {
+            /* Too fragmented to describe: compute everything */
+            job->rect_count = 0;
+            job_add_rect(job, 0, 0, w, h);
+            return;
+        }
+        
+        /* Same runs as the band above: grow those rectangles downwards */
+        int count = job->rect_count - first, same = (count == prev_count);
+        for (int i = 0; same && i < count; i++) {
+            const Rect *a = &job->rects[prev_first + i], *b = &job->rects[first + i];
+            same = (a->x0 == b->x0 && a->x1 == b->x1 && a->y1 == y);
+        }
+        if (same) {
+            for (int i = 0; i < count; i++) job->rects[prev_first + i].y1 = y1;
+            job->rect_count = first;
+        } else {
+            prev_first = first;
+            prev_count = count;
+        }
+        y = y1;
+    }
+}
+
+/* ========================================================================== */
+/*                        DISTRIBUTED RENDERING                               */
+/* ========================================================================== */
+
+/*
+ * --serve PORT turns marcepan into a tile server. It takes one coordinator
+ * connection at a time and answers each tile request with the tile's
+ * iteration counts, computed on its own pool and kernels exactly like a
+ * local frame. --coordinator HOST:PORT,... sends this process's frames to
+ * such servers instead of computing them here.
+ *
+ * A request holds everything the kernels read from a WorkerTask: the
+ * tile's size and grid position, the spacing, depth, Julia constant and
+ * interior test. A deep tile adds the origin, the reference point and the
+ * series coefficients worked out for the whole frame. The server then only
+ * iterates the reference orbit, once per view and depth, and each tile
+ * comes back bit-identical to a local render. Tiles follow the alignment
+ * of the pool's own tiles, which keeps -ms results identical as well.
+ *
+ * Client and server must be the same build on the same byte order; the
+ * request size and a byte-order word reject anything else. A reply holds
+ * the raw counts, or runs of equal counts when those are shorter.
+ *
+ * The coordinator keeps up to REMOTE_WINDOW tiles in flight per host, so
+ * a server never sits idle waiting on the network. A host that fails,
+ * answers out of turn, or stays silent for REMOTE_TIMEOUT_MS is dropped,
+ * and its tiles go to the remaining hosts. With no host left, the rest of
+ * the frame is computed locally.
+ */
+#define REMOTE_TILE_W      256       /* Multiples of TILE_W/H and MS_TILE_W/H */
+#define REMOTE_TILE_H      64
+#define REMOTE_MAX_CELLS   (1 << 20) /* Largest tile a server accepts */
+#define REMOTE_WINDOW      4         /* Tiles in flight per host */
+#define REMOTE_TIMEOUT_MS  30000     /* Silence after which a host is dropped */
+#define MAX_REMOTE_HOSTS   64
+#define TILE_MAGIC         "MCPNTILE"
+#define TILE_BYTE_ORDER    0x01020304u
+
+typedef struct {
+    char magic[8];                /* TILE_MAGIC */
+    uint32_t byte_order;          /* TILE_BYTE_ORDER as written by the sender */
+    uint32_t size;                /* sizeof(TileRequest) */
+    uint32_t id;                  /* Echoed in the reply */
+    int32_t width, height;
+    int32_t max_iter;
+    int32_t julia_mode, interior_check, solid_guess;
+    int32_t deep, skip;
+    int32_t precision;            /* Precision of the frame (PREC_DOUBLE if deep) */
+    double dx, dy, gx0, gy0;      /* As in WorkerTask, for the tile's column/row 0 */
+    double julia_cr, julia_ci;
+    double ref_x, ref_y;          /* Deep: reference point relative to the origin */
+    double ar, ai, br, bi, cr, ci;    /* and the frame's series coefficients */
+    BigFix origin_re, origin_im;
+} TileRequest;
+
+typedef struct {
+    char magic[8];                /* TILE_MAGIC */
+    uint32_t id;
+    uint32_t status;              /* 0 = ok, else the request was rejected */
+    uint32_t runs;                /* Payload is (count, length - 1) pairs, else counts */
+    uint32_t size;                /* Payload bytes */
+} TileReply;
+
+typedef struct {
+    char *name;                   /* host:port as given */
+    int fd;                       /* -1 once dropped */
+    int tiles[REMOTE_WINDOW];     /* In flight, oldest first */
+    int count;
+    double since_ms;              /* When the wait for tiles[0] began */
+} RemoteHost;
+
+static const char *coordinator_hosts;    /* --coordinator list */
+static RemoteHost remote_hosts[MAX_REMOTE_HOSTS];
+static int remote_count = 0;
+static int remote_live = 0;       /* Hosts still answering */
+static Rect *remote_tiles;        /* Tiles of the job being distributed */
+static int *remote_todo;          /* Indices not yet sent, taken from the end */
+static int remote_capacity;
+static IterCount *remote_buf;     /* One reply payload */
+
+/* Pixels of r computed elsewhere have no orbit to resume */
+static void forget_orbits(const WorkerTask *task, const Rect *r) {
+    if (!task->orbits) return;
+    for (int row = r->y0; row < r->y1; row++)
+        for (int col = r->x0; col < r->x1; col++)
+            task->orbits[(size_t)row * task->width + col].zr = INFINITY;
+}
+
+/* Runs of equal counts as (count, length - 1) pairs; 0 unless shorter than n */
+static size_t encode_runs(const IterCount *in, size_t n, IterCount *out) {
+    size_t k = 0;
+    for (size_t i = 0; i < n; ) {
+        size_t j = i + 1;
+        while (j < n && in[j] == in[i] && j - i <= UINT16_MAX) j++;
+        if (k + 2 >= n) return 0;
+        out[k++] = in[i];
+        out[k++] = (IterCount)(j - i - 1);
+        i = j;
+    }
+    return k;
+}
+
+/* Unpack a reply into tile r of task's buffer; -1 unless it fills it exactly */
+static int decode_tile(const WorkerTask *task, const Rect *r,
+                       const IterCount *in, size_t n, int runs) {
+    int w = r->x1 - r->x0;
+    size_t total = (size_t)w * (r->y1 - r->y0), pos = 0;
+    
+    for (size_t k = 0; k < n; k += runs ? 2 : 1) {
+        if (runs && k + 1 >= n) return -1;
+        size_t len = runs ? (size_t)in[k + 1] + 1 : 1;
+        if (pos + len > total) return -1;
+        for (; len > 0; len--, pos++)
+            task->output[(size_t)(r->y0 + pos / w) * task->width + r->x0 + pos % w] = in[k];
+    }
+    if (pos != total) return -1;
+    
+    forget_orbits(task, r);       /* The server's orbits stay there */
+    return 0;
+}
+
+/* Compute the whole of job->task on the pool */
+static void job_whole(FrameJob *job) {
+    job->rect_count = 0;
+    job->mirror = (Rect){ 0, 0, 0, 0 };
+    job->stride = job->coarse = 1;
+    job->resume_from = 0;
+    job_add_rect(job, 0, 0, job->task.width, job->task.height);
+    prepare_frame_job(job);
+}
+
+static int tile_request_ok(const TileRequest *req) {
+    /* Every double serve_tile() uses; the coordinator zeroes the deep ones otherwise */
+    const double values[] = {
+        req->dx, req->dy, req->gx0, req->gy0, req->julia_cr, req->julia_ci,
+        req->ref_x, req->ref_y, req->ar, req->ai, req->br, req->bi, req->cr, req->ci
+    };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+        if (!isfinite(values[i])) return 0;
+    
+    return !memcmp(req->magic, TILE_MAGIC, 8) && req->byte_order == TILE_BYTE_ORDER &&
+           req->size == sizeof(*req) &&
+           req->width >= 1 && req->height >= 1 &&
+           req->width <= REMOTE_MAX_CELLS && req->height <= REMOTE_MAX_CELLS &&
+           (size_t)req->width * req->height <= REMOTE_MAX_CELLS &&
+           req->max_iter >= 1 && req->max_iter <= MAX_ITERATIONS &&
+           req->dx > 0 && req->dy > 0 &&
+           !(req->deep && req->julia_mode) && req->skip >= 0 &&
+           req->precision >= PREC_FLOAT && req->precision <= PREC_LONG;
+}
+
+/* Server side: compute the requested tile into out */
+static int serve_tile(const TileRequest *req, IterCount *out) {
+    FrameJob *job = &frame_job;
+    WorkerTask *task = &job->task;
+    *task = (WorkerTask){
+        .width = req->width, .height = req->height,
+        .max_iter = req->max_iter,
+        .dx = req->dx, .dy = req->dy,
+        .gx0 = req->gx0, .gy0 = req->gy0,
+        .julia_mode = req->julia_mode,
+        .julia_cr = req->julia_cr, .julia_ci = req->julia_ci,
+        .interior_check = req->interior_check,
+        .precision = req->deep ? PREC_DOUBLE : (Precision)req->precision,
+        .output = out
+    };
+    set_period_eps(task);
+    
+    if (req->deep) {
+        DeepOrbit *o = &deep_orbit;
+        if (o->max_iter != req->max_iter || o->ref_x != req->ref_x || o->ref_y != req->ref_y ||
+            memcmp(&view_origin_re, &req->origin_re, sizeof(BigFix)) ||
+            memcmp(&view_origin_im, &req->origin_im, sizeof(BigFix))) {
+            view_origin_re = req->origin_re;
+            view_origin_im = req->origin_im;
+            if (deep_reference(o, req->ref_x, req->ref_y, req->max_iter) != 0) return -1;
+        }
+        if (req->skip > o->last) return -1;
+        o->skip = req->skip;
+        o->ar = req->ar; o->ai = req->ai;
+        o->br = req->br; o->bi = req->bi;
+        o->cr = req->cr; o->ci = req->ci;
+        task->deep = o;
+        task->interior_check = 0;
+    }
+    
+    solid_guess = req->solid_guess;
+    job_whole(job);
+    pool_run(compute_job, job);
+    return 0;
+}
+
+/* Answer requests on fd until the coordinator hangs up or sends garbage */
+static void serve_connection(int fd) {
+    IterCount *out = NULL, *runs = NULL;
+    size_t capacity = 0;
+    TileRequest req;
+    
+    while (safe_read(fd, &req, sizeof(req)) == 0) {
+        TileReply rep = { .id = req.id };
+        memcpy(rep.magic, TILE_MAGIC, 8);
+        const IterCount *payload = NULL;
+        size_t n = 0;
+        
+        if (!tile_request_ok(&req)) {
+            rep.status = 1;
+        } else {
+            size_t count = (size_t)req.width * req.height;
+            if (count > capacity) {
+                free(out);
+                free(runs);
+                out = malloc(count * sizeof(IterCount));
+                runs = malloc(count * sizeof(IterCount));
+                capacity = (out && runs) ? count : 0;
+            }
+            if (!capacity || serve_tile(&req, out) != 0) {
+                rep.status = 2;
+            } else {
+                n = encode_runs(out, count, runs);
+                rep.runs = n > 0;
+                payload = n ? runs : out;
+                if (!n) n = count;
+            }
+        }
+        
+        rep.size = (uint32_t)(n * sizeof(IterCount));
+        struct iovec iov[2] = {
+            { &rep, sizeof(rep) },
+            { (void *)payload, rep.size }
+        };
+        if (safe_writev(fd, iov, payload ? 2 : 1) != 0 || rep.status) break;
+    }
+    free(out);
+    free(runs);
+}
+
+static void set_socket_options(int fd) {
+    int on = 1;
+    struct timeval tv = { REMOTE_TIMEOUT_MS / 1000, 0 };
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+static int run_server(const char *port) {
+    struct addrinfo hints = { .ai_flags = AI_PASSIVE, .ai_socktype = SOCK_STREAM }, *res;
+    int err = getaddrinfo(NULL, port, &hints, &res);
+    if (err) {
+        fprintf(stderr, "Error: --serve %s: %s\n", port, gai_strerror(err));
+        return -1;
+    }
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || listen(fd, 8) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (fd < 0) {
+        fprintf(stderr, "Error: cannot listen on port %s: %s\n", port, strerror(errno));
+        return -1;
+    }
+    
+    fprintf(stderr, "Serving tiles on port %s: %s backend, %d thread%s, %s kernel\n",
+            port, active_backend->name, pool_size(), pool_size() == 1 ? "" : "s",
+            active_kernel->name);
+    for (;;) {
+        int c = accept(fd, NULL, NULL);
+        if (c < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("accept");
+            close(fd);
+            return -1;
+        }
+        set_socket_options(c);
+        serve_connection(c);
+        close(c);
+    }
+}
+
+/* Connect to HOST:PORT, or [HOST]:PORT for IPv6; -1 on failure */
+static int connect_host(const char *name) {
+    char host[256];
+    const char *colon = strrchr(name, ':');
+    size_t len = colon ? (size_t)(colon - name) : 0;
+    if (!colon || !colon[1] || len >= sizeof(host)) {
+        fprintf(stderr, "Error: '%s' is not HOST:PORT\n", name);
+        return -1;
+    }
+    if (name[0] == '[' && len >= 2 && name[len - 1] == ']') {
+        memcpy(host, name + 1, len - 2);
+        host[len - 2] = '\0';
+    } else {
+        memcpy(host, name, len);
+        host[len] = '\0';
+    }
+    
+    struct addrinfo hints = { .ai_socktype = SOCK_STREAM }, *res;
+    int err = getaddrinfo(host, colon + 1, &hints, &res);
+    if (err) {
+        fprintf(stderr, "Error: %s: %s\n", name, gai_strerror(err));
+        return -1;
+    }
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (fd < 0) {
+        fprintf(stderr, "Error: cannot connect to %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    set_socket_options(fd);
+    return fd;
+}
+
+/* Connect to a comma-separated host list; returns how many hosts answered */
+static int remote_connect(const char *list) {
+    remote_buf = malloc(REMOTE_TILE_W * REMOTE_TILE_H * sizeof(IterCount));
+    if (!remote_buf) return 0;
+    
+    for (const char *p = list; *p && remote_count < MAX_REMOTE_HOSTS; ) {
+        size_t len = strcspn(p, ",");
+        char *name = strndup(p, len);
+        p += len + (p[len] == ',');
+        if (!name) return remote_live;
+        if (!len) {
+            free(name);
+            continue;
+        }
+        RemoteHost *h = &remote_hosts[remote_count++];
+        h->name = name;
+        h->fd = connect_host(name);
+        h->count = 0;
+        if (h->fd >= 0) remote_live++;
+    }
+    return remote_live;
+}
+
+static int remote_init(void) {
+    if (!coordinator_hosts) {
+        fprintf(stderr, "Error: the remote backend is selected with --coordinator HOSTS\n");
+        return -1;
+    }
+    if (remote_connect(coordinator_hosts) > 0) return 0;
+    fprintf(stderr, "Error: no --coordinator host could be reached\n");
+    return -1;
+}
+
+static int remote_fp64(void) {
+    return 1;
+}
+
+/* Progressive passes and resumed orbits need state only this process has */
+static int remote_accepts(const FrameJob *job) {
+    return remote_live > 0 && job->stride == 1 && job->coarse && !job->resume_from;
+}
+
+static void remote_close(void) {
+    for (int i = 0; i < remote_count; i++) {
+        if (remote_hosts[i].fd >= 0) close(remote_hosts[i].fd);
+        free(remote_hosts[i].name);
+    }
+    free(remote_tiles);
+    free(remote_todo);
+    free(remote_buf);
+}
+
+/* Give up on a host; its tiles in flight go back to the queue */
+static void remote_drop(RemoteHost *h, int *todo) {
+    if (batch_mode) fprintf(stderr, "Warning: dropping %s, its tiles go to the other hosts\n",
+                            h->name);
+    close(h->fd);
+    h->fd = -1;
+    while (h->count > 0) remote_todo[(*todo)++] = h->tiles[--h->count];
+    remote_live--;
+}
+
+static int send_tile(RemoteHost *h, const FrameJob *job, int index,
+                     const BigFix *origin_re, const BigFix *origin_im) {
+    const WorkerTask *task = &job->task;
+    const Rect *r = &remote_tiles[index];
+    TileRequest req;
+    memset(&req, 0, sizeof(req));
+    memcpy(req.magic, TILE_MAGIC, 8);
+    req.byte_order = TILE_BYTE_ORDER;
+    req.size = sizeof(req);
+    req.id = (uint32_t)index;
+    req.width = r->x1 - r->x0;
+    req.height = r->y1 - r->y0;
+    req.max_iter = task->max_iter;
+    req.julia_mode = task->julia_mode;
+    req.interior_check = task->interior_check;
+    req.precision = task->precision;
+    req.solid_guess = job->solid_guess;
+    req.dx = task->dx;
+    req.dy = task->dy;
+    req.gx0 = task->gx0 + r->x0;
+    req.gy0 = task->gy0 - r->y0;
+    req.julia_cr = task->julia_cr;
+    req.julia_ci = task->julia_ci;
+    if (task->deep) {
+        const DeepOrbit *o = task->deep;
+        req.deep = 1;
+        req.skip = o->skip;
+        req.ref_x = o->ref_x; req.ref_y = o->ref_y;
+        req.ar = o->ar; req.ai = o->ai;
+        req.br = o->br; req.bi = o->bi;
+        req.cr = o->cr; req.ci = o->ci;
+        req.origin_re = *origin_re;
+        req.origin_im = *origin_im;
+    }
+    if (safe_write(h->fd, &req, sizeof(req)) != 0) return -1;
+    if (h->count == 0) h->since_ms = now_ms();
+    h->tiles[h->count++] = index;
+    return 0;
+}
+
+/* Read the reply to the host's oldest tile into the frame */
+static int receive_tile(RemoteHost *h, const FrameJob *job) {
+    TileReply rep;
+    const Rect *r = &remote_tiles[h->tiles[0]];
+    size_t cells = (size_t)(r->x1 - r->x0) * (r->y1 - r->y0);
+    
+    if (safe_read(h->fd, &rep, sizeof(rep)) != 0 || memcmp(rep.magic, TILE_MAGIC, 8) ||
+        rep.status || rep.id != (uint32_t)h->tiles[0] ||
+        rep.size % sizeof(IterCount) || rep.size > cells * sizeof(IterCount) ||
+        safe_read(h->fd, remote_buf, rep.size) != 0 ||
+        decode_tile(&job->task, r, remote_buf, rep.size / sizeof(IterCount), rep.runs) != 0)
+        return -1;
+    
+    h->count--;
+    memmove(h->tiles, h->tiles + 1, (size_t)h->count * sizeof(int));
+    h->since_ms = now_ms();
+    return 0;
+}
+
+/*
+ * Pool job for a distributed frame: worker 0 cuts the job's rectangles
+ * into tiles and keeps the hosts' windows full until every tile is back.
+ * A cancelled job sends nothing more but still collects the tiles in
+ * flight, so the next job starts on quiet connections.
+ */
+static void remote_job(void *ctx, int worker_id) {
+    FrameJob *job = ctx;
+    job->busy_ms[worker_id] = 0;  /* The work is done elsewhere */
+    job->iterations[worker_id] = 0;
+    if (worker_id) return;
+    
+    int n = 0;
+    for (int i = 0; i < job->rect_count; i++) {
+        const Rect *r = &job->rects[i];
+        n += (r->x1 - r->x0 + REMOTE_TILE_W - 1) / REMOTE_TILE_W *
+             ((r->y1 - r->y0 + REMOTE_TILE_H - 1) / REMOTE_TILE_H);
+    }
+    if (n > remote_capacity) {
+        free(remote_tiles);
+        free(remote_todo);
+        remote_tiles = malloc((size_t)n * sizeof(Rect));
+        remote_todo = malloc((size_t)n * sizeof(int));
+        remote_capacity = (remote_tiles && remote_todo) ? n : 0;
+        if (!remote_capacity) {
+            for (int i = 0; i < job->rect_count; i++) {
+                const Rect *r = &job->rects[i];
+                compute_rect(job, r->x0, r->y0, r->x1, r->y1);
+            }
+            return;
+        }
+    }
+    
+    n = 0;
+    for (int i = 0; i < job->rect_count; i++) {
+        const Rect *r = &job->rects[i];
+        for (int y = r->y0; y < r->y1; y += REMOTE_TILE_H)
+            for (int x = r->x0; x < r->x1; x += REMOTE_TILE_W)
+                remote_tiles[n++] = (Rect){ x, y,
+                    x + REMOTE_TILE_W < r->x1 ? x + REMOTE_TILE_W : r->x1,
+                    y + REMOTE_TILE_H < r->y1 ? y + REMOTE_TILE_H : r->y1 };
+    }
+    int todo = n;
+    for (int i = 0; i < n; i++) remote_todo[i] = n - 1 - i;
+    BigFix origin_re = view_origin_re, origin_im = view_origin_im;
+    
+    for (;;) {
+        if (atomic_load_explicit(&job->cancel, memory_order_relaxed)) todo = 0;
+        
+        struct pollfd fds[MAX_REMOTE_HOSTS];
+        int waiting = 0;
+        double now = now_ms(), wake = now + 100;   /* Look at the cancel flag this often */
+        for (int i = 0; i < remote_count; i++) {
+            RemoteHost *h = &remote_hosts[i];
+            while (h->fd >= 0 && h->count < REMOTE_WINDOW && todo > 0) {
+                if (send_tile(h, job, remote_todo[todo - 1], &origin_re, &origin_im) != 0) {
+                    remote_drop(h, &todo);
+                } else {
+                    todo--;
+                }
+            }
+            fds[i] = (struct pollfd){ .fd = h->count ? h->fd : -1, .events = POLLIN };
+            if (h->count) {
+                waiting++;
+                if (h->since_ms + REMOTE_TIMEOUT_MS < wake) wake = h->since_ms + REMOTE_TIMEOUT_MS;
+            }
+        }
+        
+        if (!waiting) {
+            /* Done, or no host left: the rest is computed here */
+            while (todo > 0) {
+                const Rect *r = &remote_tiles[remote_todo[--todo]];
+                compute_rect(job, r->x0, r->y0, r->x1, r->y1);
+            }
+            return;
+        }
+        
+        poll(fds, (nfds_t)remote_count, wake > now ? (int)(wake - now) + 1 : 0);
+        now = now_ms();
+        for (int i = 0; i < remote_count; i++) {
+            RemoteHost *h = &remote_hosts[i];
+            if (!h->count) continue;
+            if (fds[i].revents) {
+                if (receive_tile(h, job) != 0) remote_drop(h, &todo);
+            } else if (now - h->since_ms > REMOTE_TIMEOUT_MS) {
+                remote_drop(h, &todo);
+            }
+        }
+    }
+}
+
+/* ========================================================================== */
+/*                             GPU BACKEND                                    */
+/* ========================================================================== */
+
+/*
+ * --backend gpu runs the escape-time loop as an OpenCL kernel. The library
+ * is opened at run time, so building needs no OpenCL headers and running
+ * needs no OpenCL library; the declarations below are all that is used.
+ * The kernel is escape_scalar() transcribed with contraction off, so a
+ * device with IEEE doubles produces the same counts as the CPU kernels,
+ * interior shortcuts included.
+ *
+ * The device is the first GPU with double precision, else any device
+ * with it. A device without doubles is reported by gpu_fp64() and left
+ * unused. Perturbation (deep zoom), progressive passes, resumed orbits
+ * and -ms stay on the pool. A job runs in chunks of GPU_CHUNK_CELLS, so a
+ * cancelled frame stops early and no single launch runs long enough to
+ * trip a display watchdog. If the device fails, the CPU takes over.
+ */
+#define GPU_CHUNK_CELLS  (1 << 20)
+
+typedef int32_t cl_int;
+typedef uint32_t cl_uint;
+typedef uint64_t cl_ulong;
+typedef struct _cl_platform_id *cl_platform_id;
+typedef struct _cl_device_id *cl_device_id;
+typedef struct _cl_context *cl_context;
+typedef struct _cl_command_queue *cl_command_queue;
+typedef struct _cl_mem *cl_mem;
+typedef struct _cl_program *cl_program;
+typedef struct _cl_kernel *cl_kernel;
+typedef struct _cl_event *cl_event;
+
+#define CL_SUCCESS                  0
+#define CL_TRUE                     1
+#define CL_DEVICE_TYPE_GPU          (1 << 2)
+#define CL_DEVICE_TYPE_ALL          0xFFFFFFFFu
+#define CL_DEVICE_TYPE              0x1000
+#define CL_DEVICE_NAME              0x102B
+#define CL_DEVICE_DOUBLE_FP_CONFIG  0x1032
+#define CL_MEM_WRITE_ONLY           (1 << 1)
+#define CL_PROGRAM_BUILD_LOG        0x1183
+
+#define CL_FUNCTIONS(X) \
+    X(cl_int, clGetPlatformIDs, (cl_uint, cl_platform_id *, cl_uint *)) \
+    X(cl_int, clGetDeviceIDs, (cl_platform_id, cl_ulong, cl_uint, cl_device_id *, cl_uint *)) \
+    X(cl_int, clGetDeviceInfo, (cl_device_id, cl_uint, size_t, void *, size_t *)) \
+    X(cl_context, clCreateContext, (const intptr_t *, cl_uint, const cl_device_id *, \
+        void (*)(const char *, const void *, size_t, void *), void *, cl_int *)) \
+    X(cl_command_queue, clCreateCommandQueue, (cl_context, cl_device_id, cl_ulong, cl_int *)) \
+    X(cl_program, clCreateProgramWithSource, (cl_context, cl_uint, const char **, \
+        const size_t *, cl_int *)) \
+    X(cl_int, clBuildProgram, (cl_program, cl_uint, const cl_device_id *, const char *, \
+        void (*)(cl_program, void *), void *)) \
+    X(cl_int, clGetProgramBuildInfo, (cl_program, cl_device_id, cl_uint, size_t, void *, \
+        size_t *)) \
+    X(cl_kernel, clCreateKernel, (cl_program, const char *, cl_int *)) \
+    X(cl_mem, clCreateBuffer, (cl_context, cl_ulong, size_t, void *, cl_int *)) \
+    X(cl_int, clSetKernelArg, (cl_kernel, cl_uint, size_t, const void *)) \
+    X(cl_int, clEnqueueNDRangeKernel, (cl_command_queue, cl_kernel, cl_uint, const size_t *, \
+        const size_t *, const size_t *, cl_uint, const cl_event *, cl_event *)) \
+    X(cl_int, clEnqueueReadBuffer, (cl_command_queue, cl_mem, cl_uint, size_t, size_t, \
+        void *, cl_uint, const cl_event *, cl_event *)) \
+    X(cl_int, clReleaseMemObject, (cl_mem)) \
+    X(cl_int, clReleaseKernel, (cl_kernel)) \
+    X(cl_int, clReleaseProgram, (cl_program)) \
+    X(cl_int, clReleaseCommandQueue, (cl_command_queue)) \
+    X(cl_int, clReleaseContext, (cl_context))
+
+#define CL_DECLARE(ret, name, args) static ret (*p_##name) args;
+CL_FUNCTIONS(CL_DECLARE)
+
+static const char gpu_source[] =
+    "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n"
+    "#pragma OPENCL FP_CONTRACT OFF\n"
+    "__kernel void escape(__global ushort *out, int w, int x0, int y0, int max_n,\n"
+    "                     double dx, double dy, double gx0, double gy0, int julia,\n"
+    "                     double jr, double ji, int interior, double eps2) {\n"
+    "    int i = get_global_id(0), j = get_global_id(1);\n"
+    "    double px = (gx0 + (x0 + i)) * dx, py = (gy0 - (y0 + j)) * dy;\n"
+    "    double zr = julia ? px : 0, zi = julia ? py : 0;\n"
+    "    double cr = julia ? jr : px, ci = julia ? ji : py;\n"
+    "    int n = 0;\n"
+    "    if (interior && !julia) {\n"
+    "        double y2 = ci * ci;\n"
+    "        double xq = cr - 0.25;\n"
+    "        double q = xq * xq + y2;\n"
+    "        double xb = cr + 1.0;\n"
+    "        if (q * (q + xq) <= 0.25 * y2 || xb * xb + y2 <= 0.0625) n = max_n;\n"
+    "    }\n"
+    "    double sr = zr, si = zi;\n"
+    "    int period = 1, next_save = 1;\n"
+    "    for (; n < max_n; n++) {\n"
+    "        double zr2 = zr * zr;\n"
+    "        double zi2 = zi * zi;\n"
+    "        if (zr2 + zi2 > 4.0) break;\n"
+    "        zi = 2 * zr * zi + ci;\n"
+    "        zr = zr2 - zi2 + cr;\n"
+    "        if (!interior) continue;\n"
+    "        double er = zr - sr, ei = zi - si;\n"
+    "        if (er * er + ei * ei < eps2) {\n"
+    "            n = max_n;\n"
+    "            break;\n"
+    "        }\n"
+    "        if (n + 1 == next_save) {\n"
+    "            sr = zr; si = zi;\n"
+    "            period *= 2;\n"
+    "            next_save += period;\n"
+    "        }\n"
+    "    }\n"
+    "    out[j * w + i] = (ushort)n;\n"
+    "}\n";
+
+static void *gpu_lib;
+static cl_context gpu_context;
+static cl_command_queue gpu_queue;
+static cl_program gpu_program;
+static cl_kernel gpu_kernel;
+static cl_mem gpu_out;
+static IterCount *gpu_staging;    /* One chunk, read back from gpu_out */
+static int gpu_has_fp64;
+static int gpu_failed;            /* The device stopped working; use the CPU */
+static char gpu_device[128];
+
+/* Open the library and set up the device; NULL on success, else why not */
+static const char *gpu_open(void) {
+    gpu_lib = dlopen("libOpenCL.so.1", RTLD_NOW);
+    if (!gpu_lib) gpu_lib = dlopen("libOpenCL.so", RTLD_NOW);
+    if (!gpu_lib) return "libOpenCL.so.1 not found";
+#define CL_LOAD(ret, name, args) \
+    if (!(*(void **)&p_##name = dlsym(gpu_lib, #name))) return "incomplete OpenCL library";
+    CL_FUNCTIONS(CL_LOAD)
+#undef CL_LOAD
+    
+    cl_platform_id platforms[16];
+    cl_uint np = 0;
+    if (p_clGetPlatformIDs(16, platforms, &np) != CL_SUCCESS || np == 0)
+        return "no OpenCL platform";
+    if (np > 16) np = 16;
+    
+    /* Doubles first, then GPUs */
+    cl_device_id device = NULL;
+    int best = -1;
+    for (cl_uint p = 0; p < np; p++) {
+        cl_device_id devices[16];
+        cl_uint nd = 0;
+        if (p_clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, 16, devices, &nd) != CL_SUCCESS)
+            continue;
+        for (cl_uint d = 0; d < nd && d < 16; d++) {
+            cl_ulong type = 0, fp = 0;
+            p_clGetDeviceInfo(devices[d], CL_DEVICE_TYPE, sizeof(type), &type, NULL);
+            p_clGetDeviceInfo(devices[d], CL_DEVICE_DOUBLE_FP_CONFIG, sizeof(fp), &fp, NULL);
+            int score = (fp != 0) * 2 + ((type & CL_DEVICE_TYPE_GPU) != 0);
+            if (score > best) {
+                best = score;
+                device = devices[d];
+            }
+        }
+    }
+    if (!device) return "no OpenCL device";
+    p_clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(gpu_device) - 1, gpu_device, NULL);
+    gpu_has_fp64 = best >= 2;
+    if (!gpu_has_fp64) return NULL;   /* No kernel to build; gpu_fp64() says why */
+    
+    cl_int err;
+    const char *src = gpu_source;
+    gpu_context = p_clCreateContext(NULL, 1, &device, NULL, NULL, &err);
+    if (err != CL_SUCCESS) return "cannot create an OpenCL context";
+    gpu_queue = p_clCreateCommandQueue(gpu_context, device, 0, &err);
+    if (err != CL_SUCCESS) return "cannot create an OpenCL queue";
+    gpu_program = p_clCreateProgramWithSource(gpu_context, 1, &src, NULL, &err);
+    if (err != CL_SUCCESS) return "cannot create the OpenCL program";
+    if (p_clBuildProgram(gpu_program, 1, &device, "", NULL, NULL) != CL_SUCCESS) {
+        char log[4096] = "";
+        p_clGetProgramBuildInfo(gpu_program, device, CL_PROGRAM_BUILD_LOG,
+                                sizeof(log) - 1, log, NULL);
+        fprintf(stderr, "%s", log);
+        return "the kernel did not build";
+    }
+    gpu_kernel = p_clCreateKernel(gpu_program, "escape", &err);
+    if (err != CL_SUCCESS) return "cannot create the OpenCL kernel";
+    gpu_out = p_clCreateBuffer(gpu_context, CL_MEM_WRITE_ONLY,
+                               GPU_CHUNK_CELLS * sizeof(IterCount), NULL, &err);
+    gpu_staging = malloc(GPU_CHUNK_CELLS * sizeof(IterCount));
+    if (err != CL_SUCCESS || !gpu_staging) return "out of memory";
+    return NULL;
+}
+
+static int gpu_init(void) {
+    const char *why = gpu_open();
+    if (!why) return 0;
+    fprintf(stderr, "Warning: no GPU backend (%s), computing on the CPU\n", why);
+    return -1;
+}
+
+static void gpu_close(void) {
+    if (gpu_out) p_clReleaseMemObject(gpu_out);
+    if (gpu_kernel) p_clReleaseKernel(gpu_kernel);
+    if (gpu_program) p_clReleaseProgram(gpu_program);
+    if (gpu_queue) p_clReleaseCommandQueue(gpu_queue);
+    if (gpu_context) p_clReleaseContext(gpu_context);
+    free(gpu_staging);
+    if (gpu_lib) dlclose(gpu_lib);
+}
+
+static int gpu_fp64(void) {
+    return gpu_has_fp64;
+}
+
+static int gpu_accepts(const FrameJob *job) {
+    return gpu_has_fp64 && !gpu_failed && !job->task.deep &&
+           job->task.precision == PREC_DOUBLE && !job->solid_guess &&
+           job->stride == 1 && job->coarse && !job->resume_from;
+}
+
+/* Compute chunk c of task on the device and copy it into the buffer */
+static int gpu_chunk(const WorkerTask *task, const Rect *c) {
+    cl_int w = c->x1 - c->x0, h = c->y1 - c->y0, x0 = c->x0, y0 = c->y0;
+    cl_int max_n = task->max_iter, julia = task->julia_mode, interior = task->interior_check;
+    size_t global[2] = { (size_t)w, (size_t)h };
+    cl_kernel k = gpu_kernel;
+    
+    cl_int err = p_clSetKernelArg(k, 0, sizeof(cl_mem), &gpu_out);
+    err |= p_clSetKernelArg(k, 1, sizeof(cl_int), &w);
+    err |= p_clSetKernelArg(k, 2, sizeof(cl_int), &x0);
+    err |= p_clSetKernelArg(k, 3, sizeof(cl_int), &y0);
+    err |= p_clSetKernelArg(k, 4, sizeof(cl_int), &max_n);
+    err |= p_clSetKernelArg(k, 5, sizeof(double), &task->dx);
+    err |= p_clSetKernelArg(k, 6, sizeof(double), &task->dy);
+    err |= p_clSetKernelArg(k, 7, sizeof(double), &task->gx0);
+    err |= p_clSetKernelArg(k, 8, sizeof(double), &task->gy0);
+    err |= p_clSetKernelArg(k, 9, sizeof(cl_int), &julia);
+    err |= p_clSetKernelArg(k, 10, sizeof(double), &task->julia_cr);
+    err |= p_clSetKernelArg(k, 11, sizeof(double), &task->julia_ci);
+    err |= p_clSetKernelArg(k, 12, sizeof(cl_int), &interior);
+    err |= p_clSetKernelArg(k, 13, sizeof(double), &task->period_eps2);
+    if (err != CL_SUCCESS ||
+        p_clEnqueueNDRangeKernel(gpu_queue, k, 2, NULL, global, NULL, 0, NULL, NULL) != CL_SUCCESS ||
+        p_clEnqueueReadBuffer(gpu_queue, gpu_out, CL_TRUE, 0, (size_t)w * h * sizeof(IterCount),
+                              gpu_staging, 0, NULL, NULL) != CL_SUCCESS)
+        return -1;
+    
+    for (int row = 0; row < h; row++)
+        memcpy(task->output + (size_t)(y0 + row) * task->width + x0,
+               gpu_staging + (size_t)row * w, (size_t)w * sizeof(IterCount));
+    forget_orbits(task, c);
+    return 0;
+}
+
+/* Pool job: worker 0 feeds the device, the others have nothing to do */
+static void gpu_job(void *ctx, int worker_id) {
+    FrameJob *job = ctx;
+    job->busy_ms[worker_id] = 0;  /* The work is done elsewhere */
+    job->iterations[worker_id] = 0;
+    if (worker_id) return;
+    
+    for (int i = 0; i < job->rect_count; i++) {
+        const Rect *r = &job->rects[i];
+        int rows = GPU_CHUNK_CELLS / (r->x1 - r->x0);
+        for (int y = r->y0; y < r->y1; y += rows) {
+            if (atomic_load_explicit(&job->cancel, memory_order_relaxed)) return;
+            Rect c = { r->x0, y, r->x1, y + rows < r->y1 ? y + rows : r->y1 };
+            if (gpu_failed || gpu_chunk(&job->task, &c) != 0) {
+                gpu_failed = 1;
+                compute_rect(job, c.x0, c.y0, c.x1, c.y1);
+            }
+        }
+    }
+}
+
+/* ========================================================================== */
+/*                           COMPUTE BACKENDS                                 */
+/* ========================================================================== */
+
+static int cpu_init(void) {
+    return 0;
+}
+
+static void cpu_close(void) {
+}
+
+static int cpu_fp64(void) {
+    return 1;
+}
+
+static int cpu_accepts(const FrameJob *job) {
+    (void)job;
+    return 1;
+}
+
+/* The first one is the default and the fallback */
+static const Backend backends[] = {
+    { "cpu",    0, cpu_init,    cpu_close,    cpu_fp64,    cpu_accepts,    compute_job },
+    { "gpu",    1, gpu_init,    gpu_close,    gpu_fp64,    gpu_accepts,    gpu_job },
+    { "remote", 0, remote_init, remote_close, remote_fp64, remote_accepts, remote_job },
+};
+#define BACKEND_COUNT (sizeof(backends) / sizeof(backends[0]))
+
+/*
+ * Make the named backend active and initialize it. An optional backend
+ * that cannot be used leaves the CPU active. Returns -1 if the name is
+ * unknown or a required backend failed.
+ */
+static int select_backend(const char *name) {
+    active_backend = &backends[0];
+    for (int i = 0; i < (int)BACKEND_COUNT; i++) {
+        if (strcmp(backends[i].name, name)) continue;
+        if (backends[i].init() != 0) {
+            backends[i].close();
+            return backends[i].optional ? 0 : -1;
+        }
+        active_backend = &backends[i];
+        if (!active_backend->fp64())
+            fprintf(stderr, "Warning: %s has no double precision, computing on the CPU\n",
+                    active_backend == &backends[1] ? gpu_device : name);
+        return 0;
+    }
+    fprintf(stderr, "Error: backend '%s' is unknown\n", name);
+    return -1;
+}
+
+/* ========================================================================== */
+/*                            FRAME SETUP                                     */
+/* ========================================================================== */
+
+/*
+ * Iteration buffers. At most two frames are alive at once (the one on
+ * screen and the one being computed), so released buffers are kept and
+ * handed out again; they are only reallocated when the frame outgrows them.
+ */
+#define ITER_BUFFERS 3
+
+static struct {
+    IterCount *data;
+    size_t capacity;              /* In pixels */
+    int in_use;
+} iter_buffers[ITER_BUFFERS];
+
+static IterCount *iter_buffer_get(size_t count) {
+    int pick = -1;
+    for (int i = 0; i < ITER_BUFFERS; i++) {
+        if (iter_buffers[i].in_use) continue;
+        if (pick < 0 || (iter_buffers[i].capacity >= count &&
+                         iter_buffers[pick].capacity < count))
+            pick = i;
+    }
+    if (pick < 0) return NULL;
+    
+    if (iter_buffers[pick].capacity < count) {
+        free(iter_buffers[pick].data);
+        iter_buffers[pick].data = malloc(count * sizeof(IterCount));
+        iter_buffers[pick].capacity = iter_buffers[pick].data ? count : 0;
+        if (!iter_buffers[pick].data) return NULL;
+        pool_first_touch(iter_buffers[pick].data, count * sizeof(IterCount));
+    }
+    iter_buffers[pick].in_use = 1;
+    return iter_buffers[pick].data;
+}
+
+static void iter_buffer_put(IterCount *data) {
+    for (int i = 0; i < ITER_BUFFERS; i++)
+        if (data && iter_buffers[i].data == data) iter_buffers[i].in_use = 0;
+}
+
+static void iter_buffers_free(void) {
+    for (int i = 0; i < ITER_BUFFERS; i++) {
+        free(iter_buffers[i].data);
+        iter_buffers[i].data = NULL;
+        iter_buffers[i].capacity = 0;
+        iter_buffers[i].in_use = 0;
+    }
+}
+
+/* Orbit buffers for keep_orbits: one for the frame on screen, one for the next */
+static struct {
+    OrbitPoint *data;
+    size_t capacity;
+} orbit_buffers[2];
+
+static OrbitPoint *orbit_buffer_get(const OrbitPoint *in_use, size_t count) {
+    int i = (orbit_buffers[0].data && orbit_buffers[0].data == in_use) ? 1 : 0;
+    if (orbit_buffers[i].capacity < count) {
+        free(orbit_buffers[i].data);
+        orbit_buffers[i].data = malloc(count * sizeof(OrbitPoint));
+        orbit_buffers[i].capacity = orbit_buffers[i].data ? count : 0;
+        if (orbit_buffers[i].data)
+            pool_first_touch(orbit_buffers[i].data, count * sizeof(OrbitPoint));
+    }
+    return orbit_buffers[i].data;
+}
+
+/*
+ * Arithmetic for the snapped view. Perturbation deltas are always doubles.
+ * Otherwise --precision decides, or in auto mode: float for shallow views
+ * (at most FLOAT_MAX_ITER iterations, pixels at least FLOAT_SPACING wide)
+ * when the kernel has more float lanes than double ones - the GPU kernel
+ * is double only - long double for Julia views past DEEP_SPACING, and
+ * double for everything else.
+ */
+#define FLOAT_SPACING  1e-5      /* Float ulps near |c| = 2 stay under 1/40 pixel */
+#define FLOAT_MAX_ITER 128       /* Rounding outgrows a pixel on longer orbits */
+
+static Precision view_precision(void) {
+    if (view_deep) return PREC_DOUBLE;
+    if (precision_mode != PREC_AUTO) return precision_mode;
+    double px = grid_dx < grid_dy ? grid_dx : grid_dy;
+    if (julia_mode && px < DEEP_SPACING && LDBL_MANT_DIG > DBL_MANT_DIG) return PREC_LONG;
+    if (max_iter <= FLOAT_MAX_ITER && px >= FLOAT_SPACING &&
+        active_kernel->lanes32 > active_kernel->lanes &&
+        active_backend->compute != gpu_job)
+        return PREC_FLOAT;
+    return PREC_DOUBLE;
+}
+
+/*
+ * Task for rows row0 .. row0 + h - 1 of the snapped view's grid, w pixels
+ * wide, with the reference orbit attached for deep views. Returns -1 if
+ * the orbit could not be allocated.
+ */
+static int view_task(WorkerTask *task, int w, int h, int row0, IterCount *out) {
+    *task = (WorkerTask){
+        .width = w, .height = h,
+        .max_iter = max_iter,
+        .dx = grid_dx, .dy = grid_dy,
+        .gx0 = grid_gx0, .gy0 = grid_gy0 - row0,
+        .julia_mode = julia_mode,
+        .julia_cr = julia_cr, .julia_ci = julia_ci,
+        .interior_check = interior_check,
+        .precision = view_precision(),
+        .output = out
+    };
+    set_period_eps(task);
+    return setup_deep(task);
+}
+
+/*
+ * Iteration grid of the next frame: the terminal, or -W/-H in batch mode.
+ * The terminal size is read at startup and on SIGWINCH (resize_view).
+ */
+static void frame_size(int *w, int *h) {
+    int rows = poster_h ? poster_h : term_h;
+    *w = poster_w ? poster_w : term_w;
+    *h = use_halfblock ? rows * 2 : rows;     /* Double rows for half-blocks */
+}
+
+/*
+ * Symmetry. Negating a coordinate negates every value derived from it
+ * without changing any rounding, so a Mandelbrot pixel at grid row -g gets
+ * exactly the count of row g, and a Julia pixel at (-x, -y) that of
+ * (x, y), since z and -z have the same square. (The one asymmetric step is
+ * a Julia orbit's first cycle check, against z0 itself; it only fires when
+ * z1 lands within a millionth of a pixel of z0.) When the grid straddles
+ * the real axis - and in Julia mode the columns straddle 0 as well - the
+ * rows past the axis, as far as their mirror images reach, are left out of
+ * the job and copied across once it is done (apply_mirror).
+ *
+ * Perturbation is not symmetric, the reference orbit is not on the axis,
+ * and Mariani-Silver guesses depend on tile boundaries, so those frames
+ * are computed in full, as are progressive passes.
+ */
+static void plan_mirror(FrameJob *job) {
+    const WorkerTask *task = &job->task;
+    int w = task->width, h = task->height;
+    job->mirror = (Rect){ 0, 0, 0, 0 };
+    if (task->deep || solid_guess || job->stride != 1 || !job->rect_count) return;
+    if (task->gy0 <= 0 || task->gy0 >= h - 1) return;
+    
+    int axis = (int)task->gy0;               /* Row of grid row 0 */
+    int rows = axis < h - 1 - axis ? axis : h - 1 - axis;
+    Rect d = { 0, axis + 1, w, axis + 1 + rows };
+    if (task->julia_mode) {
+        /* Column c mirrors column -2 gx0 - c */
+        double s = -2 * task->gx0;
+        if (s < 0 || s >= 2 * w - 1) return;
+        d.x0 = s - w + 1 > 0 ? (int)s - w + 1 : 0;
+        d.x1 = s + 1 < w ? (int)s + 1 : w;
+    }
+    
+    Rect old[MAX_JOB_RECTS];
+    int n = job->rect_count, hit = 0;
+    if (4 * n > MAX_JOB_RECTS) return;
+    memcpy(old, job->rects, n * sizeof(Rect));
+    job->rect_count = 0;
+    for (int i = 0; i < n; i++) {
+        const Rect *r = &old[i];
+        if (r->x1 <= d.x0 || r->x0 >= d.x1 || r->y1 <= d.y0 || r->y0 >= d.y1) {
+            job_add_rect(job, r->x0, r->y0, r->x1, r->y1);
+            continue;
+        }
+        int y0 = r->y0 > d.y0 ? r->y0 : d.y0, y1 = r->y1 < d.y1 ? r->y1 : d.y1;
+        job_add_rect(job, r->x0, r->y0, r->x1, d.y0);
+        job_add_rect(job, r->x0, y0, d.x0, y1);
+        job_add_rect(job, d.x1, y0, r->x1, y1);
+        job_add_rect(job, r->x0, d.y1, r->x1, r->y1);
+        hit = 1;
+    }
+    if (hit) job->mirror = d;
+}
+
+/* Fill the job's mirror rectangle from the pixels it reflects */
+static void apply_mirror(const FrameJob *job) {
+    const WorkerTask *task = &job->task;
+    const Rect *d = &job->mirror;
+    int w = task->width, axis = (int)task->gy0;
+    int s = task->julia_mode ? (int)(-2 * task->gx0) : 0;
+    if (d->x0 >= d->x1) return;
+    
+    for (int row = d->y0; row < d->y1; row++) {
+        size_t dst = (size_t)row * w, src = (size_t)(2 * axis - row) * w;
+        if (!task->julia_mode) {
+            memcpy(task->output + dst + d->x0, task->output + src + d->x0,
+                   (size_t)(d->x1 - d->x0) * sizeof(IterCount));
+        } else {
+            for (int col = d->x0; col < d->x1; col++)
+                task->output[dst + col] = task->output[src + s - col];
+        }
+        if (!task->orbits) continue;
+        for (int col = d->x0; col < d->x1; col++) {
+            /* A Julia orbit is the same from z1 on; a Mandelbrot one is conjugated */
+            OrbitPoint o = task->orbits[src + (task->julia_mode ? s - col : col)];
+            if (!task->julia_mode) { o.zi = -o.zi; o.si = -o.si; }
+            task->orbits[dst + col] = o;
+        }
+    }
+}
+
+/*
+ * Preview of a resized frame for the screen while its margins are being
+ * computed: the old frame's pixels where they overlap, stretched out from
+ * its nearest edge elsewhere. prev is shifted by sx, sy as in setup_frame.
+ */
+static IterCount *resize_preview;
+
+static IterCount *preview_frame(const IterCount *prev, int ow, int oh, int sx, int sy,
+                                int w, int h) {
+    IterCount *out = iter_buffer_get((size_t)w * h);
+    if (!out) return NULL;
+    for (int row = 0; row < h; row++) {
+        int r = row + sy < 0 ? 0 : row + sy >= oh ? oh - 1 : row + sy;
+        for (int col = 0; col < w; col++) {
+            int c = col + sx < 0 ? 0 : col + sx >= ow ? ow - 1 : col + sx;
+            out[(size_t)row * w + col] = prev[(size_t)r * ow + c];
+        }
+    }
+    return out;
+}
+
+/*
+ * Start computing the current view into a free buffer, without waiting.
+ * In half-block mode, we calculate 2x the rows.
+ *
+ * prev is the frame on screen (or NULL); workers never touch it, so it can
+ * be redrawn or saved while they run. If the view only moved by whole
+ * pixels on the same grid, the overlapping part is copied across and only
+ * the exposed strips - one L-shaped region at most - are computed.
+ * If only max_iter changed, the previous frame is clamped to a lower depth,
+ * or with keep_orbits its unfinished pixels are resumed at a higher one.
+ * Otherwise tiles found in the tile cache are copied in, and only the
+ * rest of the frame is computed.
+ *
+ * With progressive rendering, a full recompute only runs the coarse pass
+ * at PROGRESSIVE_STRIDE; start_refine() then halves the stride until
+ * refine_stride reaches 1. With a frame budget, so does any job the cost
+ * model expects to overrun it, from the stride budget_stride() picks.
+ *
+ * Returns the buffer being filled, or NULL if it could not be allocated.
+ * The frame is done when the pool signals pool_notify_fd; collect it
+ * with finish_frame().
+ */
+static IterCount *setup_frame(const IterCount *prev, int *out_w, int *out_h) {
+    double start = now_ms();
+    int w, h;
+    frame_size(&w, &h);
+    
+    update_view_origin(w, h);
+    snap_viewport_to_grid(w, h);
+    
+    IterCount *out = iter_buffer_get((size_t)w * h);
+    if (!out) return NULL;
+    
+    FrameJob *job = &frame_job;
+    if (view_task(&job->task, w, h, 0, out) != 0) {
+        iter_buffer_put(out);
+        return NULL;
+    }
+    job->rect_count = 0;
+    job->stride = job->coarse = 1;
+    job->resume_from = 0;
+    
+    const WorkerTask *old = &last_task;
+    size_t count = (size_t)w * h;
+    OrbitPoint *orbits = keep_orbits && job->task.precision != PREC_LONG
+                       ? orbit_buffer_get(old->orbits, count) : NULL;
+    job->task.orbits = orbits;
+    
+    /*
+     * New column c is old column c + sx, new row r is old row r + sy. The
+     * old frame may have another size: after a terminal resize the view
+     * keeps its spacing, and only the margins it gained are computed.
+     */
+    int valid = (prev && old->output == prev);
+    int reuse = (valid && same_pixel_spacing(&job->task, old));
+    int ow = old->width, oh = old->height;
+    double sx = job->task.gx0 - old->gx0;
+    double sy = old->gy0 - job->task.gy0;
+    if (reuse && (sx <= -w || sx >= ow || sy <= -h || sy >= oh)) reuse = 0;
+    
+    if (reuse) {
+        int cx0 = sx < 0 ? (int)-sx : 0, cx1 = ow - sx < w ? ow - (int)sx : w;
+        int ry0 = sy < 0 ? (int)-sy : 0, ry1 = oh - sy < h ? oh - (int)sy : h;
+        
+        for (int row = ry0; row < ry1; row++) {
+            memcpy(out + row * w + cx0, prev + (row + (int)sy) * ow + cx0 + (int)sx,
+                   (size_t)(cx1 - cx0) * sizeof(IterCount));
+            if (!orbits) continue;
+            OrbitPoint *dst = orbits + (size_t)row * w + cx0;
+            if (old->orbits) {
+                memcpy(dst, old->orbits + (size_t)(row + (int)sy) * ow + cx0 + (int)sx,
+                       (size_t)(cx1 - cx0) * sizeof(OrbitPoint));
+            } else {
+                for (int col = cx0; col < cx1; col++) dst[col - cx0].zr = INFINITY;
+            }
+        }
+        
+        job_add_rect(job, 0, 0, w, ry0);
+        job_add_rect(job, 0, ry1, w, h);
+        job_add_rect(job, 0, ry0, cx0, ry1);
+        job_add_rect(job, cx1, ry0, w, ry1);
+        if (!batch_mode && job->rect_count && (w != ow || h != oh))
+            resize_preview = preview_frame(prev, ow, oh, (int)sx, (int)sy, w, h);
+    } else if (valid && job->task.max_iter < old->max_iter &&
+               same_grid_but_depth(&job->task, old)) {
+        /* Shallower: counts below the new depth stay, the rest cap at it */
+        for (size_t i = 0; i < count; i++)
+            out[i] = prev[i] < job->task.max_iter ? prev[i] : (IterCount)job->task.max_iter;
+        job->task.orbits = NULL;
+    } else if (valid && orbits && old->orbits && job->task.max_iter > old->max_iter &&
+               same_grid_but_depth(&job->task, old) &&
+               (!job->task.deep || (job->task.deep->ref_x == last_ref_x &&
+                                    job->task.deep->ref_y == last_ref_y))) {
+        memcpy(out, prev, count * sizeof(IterCount));
+        job->resume_from = old->max_iter;
+        job->resume_orbits = old->orbits;
+        job_add_rect(job, 0, 0, w, h);
+    } else {
+        /* Pixels no kernel computes (cached, flood-filled) have no orbit */
+        if (orbits)
+            for (size_t i = 0; i < count; i++) orbits[i].zr = INFINITY;
+        cache_fill(job);
+        if (progressive && !batch_mode && job->rect_count) job->stride = PROGRESSIVE_STRIDE;
+    }
+    
+    /* Over budget even with mirroring: preview the whole job coarsely */
+    Rect rects[MAX_JOB_RECTS];
+    int rect_count = job->rect_count;
+    double pixels = job_pixels(job);
+    memcpy(rects, job->rects, sizeof(rects));
+    plan_mirror(job);
+    if (frame_budget_ms && !batch_mode && job->stride == 1 && !job->resume_from &&
+        job->rect_count && budget_stride(job, job_pixels(job)) > 1) {
+        memcpy(job->rects, rects, sizeof(rects));
+        job->rect_count = rect_count;
+        job->mirror = (Rect){ 0, 0, 0, 0 };
+        job->stride = budget_stride(job, pixels);
+    }
+    prepare_frame_job(job);
+    job->start_ms = start;
+    
+    *out_w = w;
+    *out_h = h;
+    return out;
+}
+
+static IterCount *start_frame(const IterCount *prev, int *out_w, int *out_h) {
+    IterCount *out = setup_frame(prev, out_w, out_h);
+    if (out) pool_submit(run_frame_job, &frame_job);
+    return out;
+}
+
+/*
+ * Start the next progressive pass over frame, the coarse frame on screen.
+ * The pass works on a copy, so frame stays intact until it is replaced.
+ */
+static IterCount *start_refine(const IterCount *frame) {
+    double start = now_ms();
+    FrameJob *job = &frame_job;
+    const WorkerTask *task = &job->task;
+    size_t count = (size_t)task->width * task->height;
+    
+    IterCount *out = iter_buffer_get(count);
+    if (!out) return NULL;
+    memcpy(out, frame, count * sizeof(IterCount));
+    
+    job->task.output = out;
+    job->stride = refine_stride / 2;
+    job->coarse = 0;
+    prepare_frame_job(job);
+    job->start_ms = start;
+    pool_submit(run_frame_job, job);
+    return out;
+}
+
+/* Ask the workers to drop the running computation at the next row */
+static void cancel_frame(void) {
+    atomic_store(&frame_job.cancel, 1);
+}
+
+/*
+ * Collect the job the pool just finished. Returns 1 if its buffer now
+ * holds a frame for display, 0 if it was cancelled and should be released.
+ */
+static int finish_frame(void) {
+    FrameJob *job = &frame_job;
+    pool_wait();
+    if (atomic_load(&job->cancel)) return 0;
+    apply_mirror(job);
+    
+    FrameStats *st = &frame_stats;
+    if (job->coarse) {
+        st->compute_ms = 0;
+        memset(st->busy_ms, 0, sizeof(st->busy_ms));
+    }
+    double ms = now_ms() - job->start_ms;
+    st->compute_ms += ms;
+    st->workers = job->workers;
+    budget_learn(job, ms);
+    for (int i = 0; i < job->workers; i++) st->busy_ms[i] += job->busy_ms[i];
+    
+    refine_stride = job->stride;
+    if (refine_stride > 1) {
+        fill_blocks(job, refine_stride);
+        last_task.output = NULL;      /* Not reusable until refined */
+    } else {
+        last_task = job->task;
+        if (job->task.deep) {
+            last_ref_x = job->task.deep->ref_x;
+            last_ref_y = job->task.deep->ref_y;
+            last_origin_re = view_origin_re;
+            last_origin_im = view_origin_im;
+        }
+        cache_store_frame(&job->task);
+    }
+    return 1;
+}
+
+/*
+ * Compute the current view synchronously (batch mode). *buffer holds the
+ * previous frame (or NULL) and is replaced by the new one.
+ */
+static int compute_fractal(IterCount **buffer, int *out_w, int *out_h) {
+    IterCount *out = setup_frame(*buffer, out_w, out_h);
+    if (!out) return -1;
+    
+    pool_run(run_frame_job, &frame_job);
+    finish_frame();
+    iter_buffer_put(*buffer);
+    *buffer = out;
+    return 0;
+}
+
+/* ========================================================================== */
+/*                            RENDERING                                       */
+/* ========================================================================== */
+
+/* Build command line that recreates current view */
+static int build_cmdline(char *buf, size_t size) {
+    const char *pal = palettes[current_palette];
+    char *p = buf;
+    char *end = buf + size - 1;
+    
+    if (view_deep) {
+        /* Absolute center at a few digits more than the pixel spacing needs */
+        BigFix re, im, t;
+        big_from_double(&t, (view_xmin + view_xmax) / 2);
+        big_add(&re, &view_origin_re, &t);
+        big_from_double(&t, (view_ymin + view_ymax) / 2);
+        big_add(&im, &view_origin_im, &t);
+        int decimals = (int)ceil(-log10(grid_dx)) + 3;
+        
+        p += snprintf(p, end - p, "marcepan --center ");
+        p += big_format(p, end - p, &re, decimals);
+        if (p < end) *p++ = ' ';
+        p += big_format(p, end - p, &im, decimals);
+        if (p < end) p += snprintf(p, end - p, " --size %.9g %.9g -i %d",
+                                   view_xmax - view_xmin, view_ymax - view_ymin, max_iter);
+    } else {
+        p += snprintf(p, end - p, "marcepan -x %.9g %.9g -y %.9g %.9g -i %d",
+                      view_xmin, view_xmax, view_ymin, view_ymax, max_iter);
+    }
+    
+    if (!use_color && p < end) p += snprintf(p, end - p, " -nc");
+    if (!use_modulo && p < end) p += snprintf(p, end - p, " -m lin");
+    if (use_halfblock && p < end) p += snprintf(p, end - p, " -hb");
+    if (true_color && p < end) p += snprintf(p, end - p, " --true-color");
+    
+    /* The tier in use whenever it is not simply double */
+    Precision prec = view_precision();
+    if (!view_deep && (prec != PREC_DOUBLE || precision_mode != PREC_AUTO) && p < end)
+        p += snprintf(p, end - p, " --precision %s", precision_names[prec]);
+    
+    if (julia_mode && p < end)
+        p += snprintf(p, end - p, " -j %.9g %.9g", julia_cr, julia_ci);
+    
+    if (p < end) p += snprintf(p, end - p, " -col %d", current_color_scheme + 1);
+    
+    /* Palette: use -pal N for builtins, --symbols '...' for custom */
+    if (current_palette < (int)BUILTIN_PALETTE_COUNT && p < end) {
+        p += snprintf(p, end - p, " -pal %d", current_palette + 1);
+        /* Also show the actual palette string for reference (not copy-paste safe) */
+        p += snprintf(p, end - p, " | \"%s\"", pal);
+    } else if (p < end) {
+        /* Custom palette - use single quotes with escaping */
+        p += snprintf(p, end - p, " --symbols '");
+        for (const char *s = pal; *s && p < end - 10; s++) {
+            if (*s == '\'') {
+                memcpy(p, "'\\''", 4);
+                p += 4;
+            } else {
+                *p++ = *s;
+            }
+        }
+        if (p < end) *p++ = '\'';
+    }
+    
+    return (int)(p - buf);
+}
+
+/*
+ * Frames are drawn through a cell model: each terminal cell is a glyph
+ * plus 256-colour foreground/background (-1 = terminal default). The
+ * cells last sent to the terminal are kept, so the next frame only has to
+ * send the cells that differ, with cursor positioning between the changed
+ * runs. A palette switch or a pan typically rewrites part of the screen
+ * instead of all of it, colour escapes included.
+ */
+typedef struct {
+    char ch;                      /* Palette char, or a GLYPH_* in half-block mode */
+    int16_t fg, bg;
+} Cell;
+
+enum { GLYPH_UPPER = 1, GLYPH_LOWER = 2 };   /* '▀' and '▄' */
+
+#define DIFF_MERGE_GAP 4          /* Resend up to this many unchanged cells
+                                     rather than position the cursor again */
+
+static Cell *screen_cells;        /* What the terminal shows; NULL = unknown */
+static Cell *frame_cells;         /* Scratch for the frame being drawn */
+static int screen_cols, screen_rows;
+static size_t cells_capacity;
+static char screen_header[MAX_CMDLINE];
+
+/* Forget the screen contents; the next frame is drawn in full */
+static void screen_invalidate(void) {
+    free(screen_cells);
+    screen_cells = NULL;
+}
+
+/* SGR parameters for every 256-colour index, formatted once */
+static char sgr_fg[256][12], sgr_bg[256][12];    /* "38;5;N", "48;5;N" */
+static uint8_t sgr_fg_len[256], sgr_bg_len[256];
+
+static void init_sgr_tables(void) {
+    for (int i = 0; i < 256; i++) {
+        sgr_fg_len[i] = (uint8_t)snprintf(sgr_fg[i], sizeof(sgr_fg[i]), "38;5;%d", i);
+        sgr_bg_len[i] = (uint8_t)snprintf(sgr_bg[i], sizeof(sgr_bg[i]), "48;5;%d", i);
+    }
+}
+
+/*
+ * Iteration value → cell, for n = 0 .. max_iter (anything above max_iter
+ * looks like max_iter). ASCII mode stores the finished cell; half-block
+ * mode stores the colour of one half in fg, -1 for points in the set.
+ * Rebuilt only when one of the settings it depends on changes.
+ */
+static Cell *cell_lut;
+static int lut_size;
+static struct {
+    int palette, scheme, modulo, color, halfblock, max_iter;
+} lut_key = { -1, -1, -1, -1, -1, -1 };
+
+static int update_cell_lut(void) {
+    if (lut_key.palette == current_palette && lut_key.scheme == current_color_scheme &&
+        lut_key.modulo == use_modulo && lut_key.color == use_color &&
+        lut_key.halfblock == use_halfblock && lut_key.max_iter == max_iter)
+        return 0;
+    
+    if (lut_size < max_iter + 1) {
+        Cell *lut = realloc(cell_lut, (size_t)(max_iter + 1) * sizeof(Cell));
+        if (!lut) return -1;
+        cell_lut = lut;
+        lut_size = max_iter + 1;
+    }
+    
+    const char *pal = palettes[current_palette];
+    int pal_len = (int)strlen(pal);
+    const uint8_t *colors = color_schemes[current_color_scheme];
+    
+    for (int n = 0; n <= max_iter; n++) {
+        if (use_halfblock) {
+            int c = use_color ? colors[n % 16] : (232 + (n % 24));
+            cell_lut[n] = (Cell){ 0, (int16_t)(n >= max_iter ? -1 : c), -1 };
+        } else {
+            char ch = iteration_to_char(n, max_iter, pal, pal_len);
+            int16_t fg = (use_color && ch != FILL_CHAR) ? iteration_to_color(n, max_iter, colors) : -1;
+            cell_lut[n] = (Cell){ ch, fg, -1 };
+        }
+    }
+    
+    lut_key.palette = current_palette; lut_key.scheme = current_color_scheme;
+    lut_key.modulo = use_modulo; lut_key.color = use_color;
+    lut_key.halfblock = use_halfblock; lut_key.max_iter = max_iter;
+    return 0;
+}
+
+/*
+ * Output segments, one band of rows per worker, kept across frames and
+ * grown as needed.
+ */
+typedef struct {
+    char *buf;
+    size_t capacity;
+    size_t len;
+} OutSegment;
+
+static OutSegment out_segs[MAX_THREADS];
+
+static int reserve_segment(OutSegment *seg, size_t size) {
+    if (size > seg->capacity) {
+        char *buf = realloc(seg->buf, size);
+        if (!buf) return -1;
+        seg->buf = buf;
+        seg->capacity = size;
+    }
+    return 0;
+}
+
+/* Decimal digits of v (v >= 0) */
+static inline char *put_uint(char *p, unsigned v) {
+    char tmp[10];
+    int n = 0;
+    do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    while (n) *p++ = tmp[--n];
+    return p;
+}
+
+/*
+ * Half-blocks: each cell shows 2 calculation rows.
+ * Uses '▀' (upper half) with FG=top, BG=bottom.
+ * 
+ * Logic for each cell:
+ *   Both in set     → space (no color)
+ *   Top in set      → '▄' with FG=bottom color, BG=black
+ *   Bottom in set   → '▀' with FG=top color, BG=black  
+ *   Neither in set  → '▀' with FG=top color, BG=bottom color
+ * 
+ * In monochrome mode: use grayscale based on iteration count.
+ */
+static void cells_halfblock(Cell *cells, const IterCount *iterations, int w, int h,
+                            int r0, int r1) {
+    const int top = max_iter;
+    for (int y = 2 * r0; y < h && y < 2 * r1; y += 2) {
+        const IterCount *row_top = iterations + y * w;
+        const IterCount *row_bot = (y + 1 < h) ? iterations + (y + 1) * w : row_top;
+        Cell *out = cells + (y / 2) * w;
+        
+        for (int x = 0; x < w; x++) {
+            int16_t c_top = cell_lut[row_top[x] < top ? row_top[x] : top].fg;
+            int16_t c_bot = cell_lut[row_bot[x] < top ? row_bot[x] : top].fg;
+            
+            if (c_top < 0 && c_bot < 0) {
+                out[x] = (Cell){ ' ', -1, -1 };
+            } else if (c_top < 0) {
+                out[x] = (Cell){ GLYPH_LOWER, c_bot, -1 };
+            } else {
+                out[x] = (Cell){ GLYPH_UPPER, c_top, c_bot };
+            }
+        }
+    }
+}
+
+/* Standard ASCII rendering (original method) */
+static void cells_ascii(Cell *cells, const IterCount *iterations, int w, int r0, int r1) {
+    const int top = max_iter;
+    for (int i = r0 * w; i < r1 * w; i++)
+        cells[i] = cell_lut[iterations[i] < top ? iterations[i] : top];
+}
+
+static inline int same_cell(const Cell *a, const Cell *b) {
+    return a->ch == b->ch && a->fg == b->fg && a->bg == b->bg;
+}
+
+/*
+ * Append cells [x0, x1) of a row. *fg, *bg track the terminal's current
+ * colours; only the parts of the SGR state that change are sent, and a
+ * cell in default colours after a coloured one resets everything.
+ */
+static char *emit_cells(char *p, const Cell *row, int x0, int x1, int *fg, int *bg) {
+    for (int x = x0; x < x1; x++) {
+        const Cell *c = &row[x];
+        
+        if (c->fg < 0 && c->bg < 0) {
+            if (*fg >= 0 || *bg >= 0) {
+                memcpy(p, "\x1b[0m", 4);
+                p += 4;
+                *fg = *bg = -1;
+            }
+        } else if (c->fg != *fg || c->bg != *bg) {
+            *p++ = '\x1b';
+            *p++ = '[';
+            if (c->fg != *fg) {
+                memcpy(p, sgr_fg[c->fg], sizeof(sgr_fg[0]));
+                p += sgr_fg_len[c->fg];
+            }
+            if (c->bg != *bg) {
+                if (c->fg != *fg) *p++ = ';';
+                if (c->bg < 0) {
+                    memcpy(p, "49", 2);
+                    p += 2;
+                } else {
+                    memcpy(p, sgr_bg[c->bg], sizeof(sgr_bg[0]));
+                    p += sgr_bg_len[c->bg];
+                }
+            }
+            *p++ = 'm';
+            *fg = c->fg;
+            *bg = c->bg;
+        }
+        
+        if (c->ch == GLYPH_UPPER) {
+            memcpy(p, "▀", 3);
+            p += 3;
+        } else if (c->ch == GLYPH_LOWER) {
+            memcpy(p, "▄", 3);
+            p += 3;
+        } else {
+            *p++ = c->ch;
+        }
+    }
+    return p;
+}
+
+static char *emit_reset(char *p, int *fg, int *bg) {
+    if (*fg >= 0 || *bg >= 0) {
+        memcpy(p, "\x1b[0m", 4);
+        p += 4;
+        *fg = *bg = -1;
+    }
+    return p;
+}
+
+/* Rows r0..r1-1 in full, each ending in default colours and a newline */
+static char *emit_full(char *p, const Cell *cells, int cols, int r0, int r1) {
+    int fg = -1, bg = -1;
+    for (int y = r0; y < r1; y++) {
+        p = emit_cells(p, cells + y * cols, 0, cols, &fg, &bg);
+        p = emit_reset(p, &fg, &bg);
+        *p++ = '\n';
+    }
+    return p;
+}
+
+/*
+ * Only the cells that differ from old. Changed runs separated by no more
+ * than DIFF_MERGE_GAP unchanged cells are sent as one; terminal row 1 is
+ * the header, so cell row y is terminal row y + 2. Every row ends in
+ * default colours, so any range of rows can be emitted on its own.
+ */
+static char *emit_diff(char *p, const Cell *cells, const Cell *old, int cols,
+                       int r0, int r1) {
+    int fg = -1, bg = -1;
+    for (int y = r0; y < r1; y++) {
+        const Cell *row = cells + y * cols, *prev = old + y * cols;
+        int x = 0;
+        
+        while (x < cols) {
+            if (same_cell(&row[x], &prev[x])) { x++; continue; }
+            int start = x, end = x + 1, gap = 0;
+            for (x = end; x < cols && gap <= DIFF_MERGE_GAP; x++) {
+                if (same_cell(&row[x], &prev[x])) {
+                    gap++;
+                } else {
+                    gap = 0;
+                    end = x + 1;
+                }
+            }
+            x = end;
+            *p++ = '\x1b';
+            *p++ = '[';
+            p = put_uint(p, (unsigned)y + 2);
+            *p++ = ';';
+            p = put_uint(p, (unsigned)start + 1);
+            *p++ = 'H';
+            p = emit_cells(p, row, start, end, &fg, &bg);
+        }
+        p = emit_reset(p, &fg, &bg);
+    }
+    return p;
+}
+
+/* 1234 -> "1.23K" and so on, for the stats overlay */
+static const char *scaled(char *buf, double v) {
+    static const char units[] = " KMGTP";
+    int u = 0;
+    while (v >= 999.5 && u < (int)sizeof(units) - 2) {
+        v /= 1000;
+        u++;
+    }
+    snprintf(buf, 16, u ? "%.3g%c" : "%.0f", v, units[u]);
+    return buf;
+}
+
+/*
+ * Cost of the frame on screen: compute time, the last draw's time and
+ * bytes, iterations, pixels stopped at max_iter, and how much longer the
+ * busiest worker ran than the average one (1.00x = perfectly balanced).
+ */
+static int format_stats(char *buf, size_t size) {
+    const FrameStats *st = &frame_stats;
+    double busy_max = 0, busy_mean = 0;
+    for (int i = 0; i < st->workers; i++) {
+        if (st->busy_ms[i] > busy_max) busy_max = st->busy_ms[i];
+        busy_mean += st->busy_ms[i] / st->workers;
+    }
+    char bytes[16], iters[16];
+    return snprintf(buf, size, "calc %.1fms draw %.1fms %sB | %s it, %.1f%% max | "
+                    "threads %.2fx | ",
+                    st->compute_ms, st->render_ms, scaled(bytes, (double)st->bytes),
+                    scaled(iters, st->iterations), st->capped * 100,
+                    busy_mean > 0.01 ? busy_max / busy_mean : 1.0);
+}
+
+/* Header line, clipped to the terminal width so it never wraps */
+static int format_header(char *buf, int cols) {
+    int n = show_stats ? format_stats(buf, MAX_CMDLINE) : 0;
+    if (n > MAX_CMDLINE - 1) n = MAX_CMDLINE - 1;
+    n += status_message[0] ? snprintf(buf + n, MAX_CMDLINE - n, "%s", status_message)
+                           : build_cmdline(buf + n, MAX_CMDLINE - n);
+    if (n > MAX_CMDLINE - 1) n = MAX_CMDLINE - 1;
+    if (n > cols) {
+        n = cols;
+        while (n > 0 && ((unsigned char)buf[n] & 0xC0) == 0x80) n--;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+/* One frame to turn into bytes; worker id formats segment id */
+typedef struct {
+    const IterCount *iterations;
+    int w, h;                 /* Iteration grid */
+    int rows;                 /* Cell rows */
+    int segments;
+    int full;                 /* Emit every cell (else a diff against screen_cells) */
+    char header[MAX_CMDLINE + 16];
+    int header_len;           /* Bytes written before the first segment */
+    size_t bytes;             /* Total written */
+} RenderJob;
+
+static RenderJob render_job;
+static int render_fd = STDOUT_FILENO;
+
+static void render_segment(void *ctx, int worker_id) {
+    RenderJob *job = ctx;
+    if (worker_id >= job->segments) return;
+    
+    int r0 = (int)((long)job->rows * worker_id / job->segments);
+    int r1 = (int)((long)job->rows * (worker_id + 1) / job->segments);
+    OutSegment *seg = &out_segs[worker_id];
+    
+    if (use_halfblock) {
+        cells_halfblock(frame_cells, job->iterations, job->w, job->h, r0, r1);
+    } else {
+        cells_ascii(frame_cells, job->iterations, job->w, r0, r1);
+    }
+    
+    char *p = job->full ? emit_full(seg->buf, frame_cells, job->w, r0, r1)
+                        : emit_diff(seg->buf, frame_cells, screen_cells, job->w, r0, r1);
+    seg->len = (size_t)(p - seg->buf);
+}
+
+/*
+ * Build the cells and their bytes in parallel, one band of rows per
+ * worker, and hand the segments to the terminal in one writev(). When
+ * the pool is still busy with a refinement pass the frame is formatted
+ * as a single segment on this thread.
+ */
+static void render_frame(const IterCount *iterations, int w, int h) {
+    double start = now_ms();
+    RenderJob *job = &render_job;
+    int rows = use_halfblock ? (h + 1) / 2 : h;
+    size_t count = (size_t)w * rows;
+    
+    if (show_stats && !batch_mode) {
+        double sum = 0;
+        size_t capped = 0, pixels = (size_t)w * h;
+        for (size_t i = 0; i < pixels; i++) {
+            if (iterations[i] >= max_iter) {
+                sum += max_iter;
+                capped++;
+            } else {
+                sum += iterations[i];
+            }
+        }
+        frame_stats.iterations = sum;
+        frame_stats.capped = pixels ? (double)capped / pixels : 0;
+    }
+    
+    if (count > cells_capacity) {
+        screen_invalidate();
+        free(frame_cells);
+        frame_cells = malloc(count * sizeof(Cell));
+        cells_capacity = frame_cells ? count : 0;
+        if (!frame_cells) return;
+    }
+    if (update_cell_lut() != 0) return;
+    
+    job->iterations = iterations;
+    job->w = w;
+    job->h = h;
+    job->rows = rows;
+    job->header_len = 0;
+    
+    int inline_run = pool_busy();
+    int segments = inline_run ? 1 : pool_size();
+    if (segments > rows) segments = rows;
+    if (segments < 1) segments = 1;
+    job->segments = segments;
+    
+    char header[MAX_CMDLINE];
+    int header_len = 0;
+    
+    if (batch_mode) {
+        job->full = 1;
+    } else {
+        header_len = format_header(header, w);
+        job->full = !screen_cells || screen_cols != w || screen_rows != rows;
+        
+        char *p = job->header;
+        if (job->full) {
+            memcpy(p, "\x1b[2J\x1b[H", 7);
+            p += 7;
+            memcpy(p, header, (size_t)header_len);
+            p += header_len;
+            *p++ = '\n';
+        } else if (strcmp(header, screen_header)) {
+            memcpy(p, "\x1b[H\x1b[2K", 7);
+            p += 7;
+            memcpy(p, header, (size_t)header_len);
+            p += header_len;
+        }
+        job->header_len = (int)(p - job->header);
+    }
+    
+    for (int i = 0; i < segments; i++) {
+        int r0 = (int)((long)rows * i / segments);
+        int r1 = (int)((long)rows * (i + 1) / segments);
+        size_t size = (size_t)w * (r1 - r0) * OUTBUF_PER_CELL + 1024;
+        if (reserve_segment(&out_segs[i], size) != 0) return;
+    }
+    
+    if (inline_run) {
+        render_segment(job, 0);
+    } else {
+        pool_run(render_segment, job);
+    }
+    
+    struct iovec iov[MAX_THREADS + 1];
+    iov[0].iov_base = job->header;
+    iov[0].iov_len = (size_t)job->header_len;
+    job->bytes = iov[0].iov_len;
+    for (int i = 0; i < segments; i++) {
+        iov[i + 1].iov_base = out_segs[i].buf;
+        iov[i + 1].iov_len = out_segs[i].len;
+        job->bytes += out_segs[i].len;
+    }
+    safe_writev(render_fd, iov, segments + 1);
+    frame_stats.render_ms = now_ms() - start;
+    frame_stats.bytes = job->bytes;
+    
+    if (!batch_mode) {
+        /* The frame just drawn becomes the screen */
+        Cell *t = screen_cells;
+        screen_cells = frame_cells;
+        frame_cells = t ? t : malloc(cells_capacity * sizeof(Cell));
+        if (!frame_cells) {
+            frame_cells = screen_cells;
+            screen_cells = NULL;
+        }
+        screen_cols = w;
+        screen_rows = rows;
+        memcpy(screen_header, header, (size_t)header_len + 1);
+    }
+}
+
+/* ========================================================================== */
+/*                           FILE EXPORT                                      */
+/* ========================================================================== */
+
+/*
+ * Raw export: the iteration buffer itself behind a small header, so a
+ * render can be presented again with any palette or mapping without being
+ * recomputed. --load maps such a file and uses it as the frame. The header
+ * records the pixel grid exactly (spacing, grid index and, for deep zoom,
+ * the fixed-point origin), and the data starts header_size bytes in, a
+ * multiple of 8. Fields are in the writer's byte order.
+ */
+#define RAW_MAGIC       "MCPNRAW\n"
+#define RAW_BYTE_ORDER  0x01020304u
+
+typedef struct {
+    char magic[8];
+    uint32_t byte_order;          /* RAW_BYTE_ORDER */
+    uint32_t header_size;         /* Offset of the iteration data */
+    uint32_t elem_size;           /* Bytes per count (sizeof(IterCount)) */
+    uint32_t width, height;       /* Iteration grid */
+    int32_t max_iter;
+    int32_t julia_mode, halfblock, interior_check, deep;
+    double dx, dy;                /* Pixel spacing */
+    double gx0, gy0;              /* Grid index of column 0 and row 0 */
+    double julia_cr, julia_ci;
+    BigFix origin_re, origin_im;  /* Deep-zoom origin the grid is relative to */
+} RawHeader;
+
+static const IterCount *loaded_data;     /* Frame mapped by --load, or NULL */
+static int loaded_w, loaded_h;
+static void *loaded_map;
+static size_t loaded_map_size;
+
+static void raw_header(RawHeader *hdr, const WorkerTask *task, int halfblock,
+                       const BigFix *origin_re, const BigFix *origin_im) {
+    memset(hdr, 0, sizeof(*hdr));
+    memcpy(hdr->magic, RAW_MAGIC, 8);
+    hdr->byte_order = RAW_BYTE_ORDER;
+    hdr->header_size = sizeof(*hdr);
+    hdr->elem_size = sizeof(IterCount);
+    hdr->width = (uint32_t)task->width;
+    hdr->height = (uint32_t)task->height;
+    hdr->max_iter = task->max_iter;
+    hdr->julia_mode = task->julia_mode;
+    hdr->halfblock = halfblock;
+    hdr->interior_check = task->interior_check;
+    hdr->deep = task->deep != NULL;
+    hdr->dx = task->dx; hdr->dy = task->dy;
+    hdr->gx0 = task->gx0; hdr->gy0 = task->gy0;
+    hdr->julia_cr = task->julia_cr; hdr->julia_ci = task->julia_ci;
+    if (task->deep) {
+        hdr->origin_re = *origin_re;
+        hdr->origin_im = *origin_im;
+    }
+}
+_Static_assert(sizeof(RawHeader) % 8 == 0, "raw data must stay aligned");
+
+/*
+ * Map a raw export and take over its view: grid, depth, Julia constant
+ * and half-block layout. Presentation settings stay as given.
+ */
+static int load_raw(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(RawHeader))
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Error: %s is not a marcepan raw file\n", path);
+        return -1;
+    }
+    
+    RawHeader hdr;
+    memcpy(&hdr, map, sizeof(hdr));
+    size_t count = (size_t)hdr.width * hdr.height;
+    /* Every double the view is taken from, and the view bounds they give */
+    const double values[] = {
+        hdr.dx, hdr.dy, hdr.gx0, hdr.gy0, hdr.julia_cr, hdr.julia_ci,
+        hdr.gx0 * hdr.dx, (hdr.gx0 + hdr.width) * hdr.dx,
+        (hdr.gy0 - hdr.height) * hdr.dy, hdr.gy0 * hdr.dy
+    };
+    int finite = 1;
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+        if (!isfinite(values[i])) finite = 0;
+    if (memcmp(hdr.magic, RAW_MAGIC, 8) || hdr.byte_order != RAW_BYTE_ORDER ||
+        hdr.elem_size != sizeof(IterCount) ||
+        hdr.header_size < sizeof(hdr) || hdr.header_size % 8 ||
+        hdr.width < 1 || hdr.width > MAX_POSTER_SIZE ||
+        hdr.height < 1 || hdr.height > MAX_POSTER_SIZE ||
+        hdr.max_iter < 1 || hdr.max_iter > MAX_ITERATIONS ||
+        !finite || !(hdr.dx > 0) || !(hdr.dy > 0) ||
+        (size_t)st.st_size < hdr.header_size + count * sizeof(IterCount)) {
+        fprintf(stderr, "Error: %s is not a marcepan raw file or is truncated\n", path);
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    
+    loaded_map = map;
+    loaded_map_size = (size_t)st.st_size;
+    loaded_data = (const IterCount *)((const char *)map + hdr.header_size);
+    loaded_w = (int)hdr.width;
+    loaded_h = (int)hdr.height;
+    
+    max_iter = hdr.max_iter;
+    julia_mode = hdr.julia_mode;
+    julia_cr = hdr.julia_cr; julia_ci = hdr.julia_ci;
+    use_halfblock = hdr.halfblock;
+    if (!hdr.deep) interior_check = hdr.interior_check;
+    
+    view_deep = hdr.deep;
+    memset(&view_origin_re, 0, sizeof(view_origin_re));
+    memset(&view_origin_im, 0, sizeof(view_origin_im));
+    if (hdr.deep) {
+        view_origin_re = hdr.origin_re;
+        view_origin_im = hdr.origin_im;
+    }
+    grid_dx = match_level(hdr.dx, level_dx, &level_next_x);
+    grid_dy = match_level(hdr.dy, level_dy, &level_next_y);
+    grid_gx0 = hdr.gx0; grid_gy0 = hdr.gy0;
+    view_xmin = hdr.gx0 * hdr.dx; view_xmax = (hdr.gx0 + hdr.width) * hdr.dx;
+    view_ymin = (hdr.gy0 - hdr.height) * hdr.dy; view_ymax = hdr.gy0 * hdr.dy;
+    return 0;
+}
+
+/* ========================================================================== */
+/*                          OFFLINE RENDERING                                 */
+/* ========================================================================== */
+
+/*
+ * Offline renders (-W/-H or -o) are not limited to the terminal and never
+ * hold the whole image. The view is snapped to the grid of the full
+ * output size once, then computed in bands of about POSTER_BAND_CELLS
+ * cells. While the pool computes band k + 1, this thread turns band k into
+ * bytes and writes it, so memory stays at two band buffers and one output
+ * buffer however large the image is. A frame from --load is written from
+ * the mapping the same way, without computing anything.
+ *
+ * Text output looks like batch mode's (ANSI colours unless -nc). A file
+ * name ending in .ppm gives a binary PPM instead: one pixel per iteration
+ * value, in the colour its half-block would have, points in the set black.
+ * .png gives the same pixels as a PNG, .raw a raw export. With
+ * --true-color both image formats spread the depth over a gradient
+ * through the scheme's colours instead.
+ */
+
+/* RGB of an xterm 256-colour index */
+static void xterm_rgb(int c, uint8_t *rgb) {
+    static const uint8_t base[16][3] = {
+        {0,0,0}, {128,0,0}, {0,128,0}, {128,128,0}, {0,0,128}, {128,0,128},
+        {0,128,128}, {192,192,192}, {128,128,128}, {255,0,0}, {0,255,0},
+        {255,255,0}, {0,0,255}, {255,0,255}, {0,255,255}, {255,255,255}
+    };
+    static const uint8_t cube[6] = { 0, 95, 135, 175, 215, 255 };
+    if (c < 16) {
+        memcpy(rgb, base[c], 3);
+    } else if (c < 232) {
+        c -= 16;
+        rgb[0] = cube[c / 36]; rgb[1] = cube[c / 6 % 6]; rgb[2] = cube[c % 6];
+    } else {
+        rgb[0] = rgb[1] = rgb[2] = (uint8_t)(8 + 10 * (c - 232));
+    }
+}
+
+/*
+ * --true-color: count n of max_iter at its place on a gradient through the
+ * scheme's 16 colours (the 24 greys with -nc), so that every depth gets a
+ * colour of its own rather than one of 16 repeating ones.
+ */
+static void gradient_rgb(int n, uint8_t *rgb) {
+    const uint8_t *colors = color_schemes[current_color_scheme];
+    int stops = use_color ? 16 : 24;
+    double t = (double)n * (stops - 1) / max_iter;
+    int i = (int)t;
+    if (i > stops - 2) i = stops - 2;
+    double f = t - i;
+    uint8_t a[3], b[3];
+    xterm_rgb(use_color ? colors[i] : 232 + i, a);
+    xterm_rgb(use_color ? colors[i + 1] : 233 + i, b);
+    for (int c = 0; c < 3; c++)
+        rgb[c] = (uint8_t)lrint(a[c] + (b[c] - a[c]) * f);
+}
+
+static int has_suffix(const char *s, const char *suffix) {
+    size_t n = strlen(s), k = strlen(suffix);
+    return n >= k && !strcmp(s + n - k, suffix);
+}
+
+/* FORMAT_PLAIN is the p key's uncoloured text, with half-blocks averaged */
+enum { FORMAT_TEXT, FORMAT_PPM, FORMAT_RAW, FORMAT_PNG, FORMAT_PLAIN };
+
+static int output_format(const char *path) {
+    if (path && has_suffix(path, ".ppm")) return FORMAT_PPM;
+    if (path && has_suffix(path, ".png")) return FORMAT_PNG;
+    if (path && has_suffix(path, ".raw")) return FORMAT_RAW;
+    return FORMAT_TEXT;
+}
+
+/* Formats with one pixel per iteration value, half-block mode or not */
+static int image_format(int format) {
+    return format == FORMAT_PPM || format == FORMAT_PNG;
+}
+
+/*
+ * PNG without a compression library: the scanlines go in stored
+ * (uncompressed) deflate blocks, so the file is about as large as the PPM
+ * but opens anywhere. Every band is an IDAT chunk of its own; the zlib
+ * header leads the image in one, the final empty block and the Adler-32
+ * close it in another, so bands can be formatted independently.
+ */
+#define PNG_BLOCK 65535           /* Largest stored deflate block */
+
+static uint32_t crc_table[256];
+
+static void init_crc_table(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[n] = c;
+    }
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t n) {
+    crc = ~crc;
+    while (n--) crc = crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static uint32_t adler32_update(uint32_t adler, const uint8_t *p, size_t n) {
+    uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    while (n > 0) {
+        size_t k = n < 5552 ? n : 5552;   /* Longest run before b can overflow */
+        n -= k;
+        while (k--) {
+            a += *p++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return a | b << 16;
+}
+
+/* Adler-32 of two runs from theirs, len2 being the length of the second */
+static uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, size_t len2) {
+    const uint32_t base = 65521;
+    uint32_t rem = (uint32_t)(len2 % base);
+    uint32_t a = adler1 & 0xFFFF;
+    uint32_t b = (uint32_t)((uint64_t)rem * a % base);
+    a += (adler2 & 0xFFFF) + base - 1;
+    b += (adler1 >> 16) + (adler2 >> 16) + base - rem;
+    if (a >= base) a -= base;
+    if (a >= base) a -= base;
+    if (b >= base << 1) b -= base << 1;
+    if (b >= base) b -= base;
+    return a | b << 16;
+}
+
+static inline uint8_t *put_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v;
+    return p + 4;
+}
+
+/* A whole chunk: length, type, data, CRC */
+static uint8_t *png_chunk(uint8_t *p, const char *type, const void *data, size_t len) {
+    uint8_t *start = put_be32(p, (uint32_t)len);
+    memcpy(start, type, 4);
+    memcpy(start + 4, data, len);
+    return put_be32(start + 4 + len, crc32_update(0, start, len + 4));
+}
+
+/*
+ * Turns iteration rows into one output format, at most a band of pixel
+ * rows at a time, through one buffer that is reused for every band.
+ * writer_format() touches nothing but its arguments and the tables, so
+ * several bands can be formatted at once (screen exports).
+ */
+typedef struct {
+    int format;
+    int sub;                      /* Pixel rows per text row (2 in half-block mode) */
+    int w, band;                  /* Grid width, pixel rows per band */
+    Cell *cells;
+    uint8_t (*rgb)[3];            /* Image colour of every count */
+    char *glyphs;                 /* FORMAT_PLAIN character of every count */
+    uint32_t adler;               /* PNG: Adler-32 of the scanlines so far */
+    OutSegment out;
+} Writer;
+
+/* Where writers send their bytes instead of fd while a daemon reply is built */
+static OutSegment *writer_sink;
+
+static int writer_put(int fd, const void *buf, size_t len) {
+    if (!writer_sink) return safe_write(fd, buf, len);
+    OutSegment *seg = writer_sink;
+    if (seg->len + len > seg->capacity &&
+        reserve_segment(seg, (seg->len + len) * 2) != 0)
+        return -1;
+    memcpy(seg->buf + seg->len, buf, len);
+    seg->len += len;
+    return 0;
+}
+
+static void writer_free(Writer *wr) {
+    free(wr->cells);
+    free(wr->rgb);
+    free(wr->glyphs);
+    free(wr->out.buf);
+}
+
+/* Bytes writer_format() may produce for h pixel rows */
+static size_t writer_bound(const Writer *wr, int h) {
+    size_t rows = (size_t)(h + wr->sub - 1) / wr->sub;
+    size_t pixels = (size_t)wr->w * h;
+    switch (wr->format) {
+    case FORMAT_PPM:   return pixels * 3;
+    case FORMAT_RAW:   return pixels * sizeof(IterCount);
+    case FORMAT_PLAIN: return (wr->w + 1) * rows;
+    case FORMAT_PNG: {
+        size_t raw = pixels * 3 + h;
+        return 12 + raw + (raw / PNG_BLOCK + 1) * 5;
+    }
+    default:           return wr->w * rows * OUTBUF_PER_CELL + 1024;
+    }
+}
+
+/* The mapping tables of a w-wide writer, without band buffers */
+static int writer_tables(Writer *wr, int format, int w) {
+    memset(wr, 0, sizeof(*wr));
+    wr->format = format;
+    wr->sub = (use_halfblock && !image_format(format)) ? 2 : 1;
+    wr->w = w;
+    wr->adler = 1;
+    
+    if (image_format(format)) {
+        wr->rgb = malloc((size_t)(max_iter + 1) * 3);
+        if (!wr->rgb) return -1;
+        const uint8_t *colors = color_schemes[current_color_scheme];
+        for (int n = 0; n <= max_iter; n++) {
+            if (n >= max_iter) {
+                memset(wr->rgb[n], 0, 3);
+            } else if (true_color) {
+                gradient_rgb(n, wr->rgb[n]);
+            } else {
+                xterm_rgb(use_color ? colors[n % 16] : 232 + n % 24, wr->rgb[n]);
+            }
+        }
+        if (format == FORMAT_PNG && !crc_table[1]) init_crc_table();
+    } else if (format == FORMAT_PLAIN) {
+        wr->glyphs = malloc((size_t)max_iter + 1);
+        if (!wr->glyphs) return -1;
+        const char *pal = palettes[current_palette];
+        int pal_len = (int)strlen(pal);
+        for (int n = 0; n <= max_iter; n++)
+            wr->glyphs[n] = iteration_to_char(n, max_iter, pal, pal_len);
+    } else if (format == FORMAT_TEXT) {
+        if (update_cell_lut() != 0) return -1;
+    }
+    return 0;
+}
+
+/* Writer for w x h grids; the band follows POSTER_BAND_CELLS */
+static int writer_init(Writer *wr, int format, int w, int h) {
+    if (writer_tables(wr, format, w) != 0) return -1;
+    wr->band = POSTER_BAND_CELLS / w * wr->sub;
+    if (wr->band < wr->sub) wr->band = wr->sub;
+    if (wr->band > h) wr->band = h;
+    
+    if (format == FORMAT_TEXT) {
+        wr->cells = malloc((size_t)w * ((wr->band + wr->sub - 1) / wr->sub) * sizeof(Cell));
+        if (!wr->cells) return -1;
+    }
+    if (format != FORMAT_RAW && reserve_segment(&wr->out, writer_bound(wr, wr->band)) != 0)
+        return -1;
+    return 0;
+}
+
+/* PPM, PNG or raw header for task's grid; starts a new image */
+static int writer_header(Writer *wr, int fd, const WorkerTask *task,
+                         const BigFix *origin_re, const BigFix *origin_im) {
+    wr->adler = 1;
+    if (wr->format == FORMAT_PNG) {
+        char cmdline[MAX_CMDLINE];
+        int n = build_cmdline(cmdline, sizeof(cmdline));
+        uint8_t header[MAX_CMDLINE + 128], ihdr[13], text[MAX_CMDLINE + 8];
+        static const uint8_t zlib_header[2] = { 0x78, 0x01 };
+        put_be32(ihdr, (uint32_t)task->width);
+        put_be32(ihdr + 4, (uint32_t)task->height);
+        memcpy(ihdr + 8, "\x08\x02\0\0\0", 5);     /* 8-bit RGB, not interlaced */
+        memcpy(text, "Comment", 8);
+        memcpy(text + 8, cmdline, (size_t)n);
+        
+        uint8_t *p = header;
+        memcpy(p, "\x89PNG\r\n\x1a\n", 8);
+        p = png_chunk(p + 8, "IHDR", ihdr, sizeof(ihdr));
+        p = png_chunk(p, "tEXt", text, (size_t)n + 8);
+        p = png_chunk(p, "IDAT", zlib_header, sizeof(zlib_header));
+        return writer_put(fd, header, (size_t)(p - header));
+    }
+    if (wr->format == FORMAT_PPM) {
+        char cmdline[MAX_CMDLINE];
+        build_cmdline(cmdline, sizeof(cmdline));
+        char header[MAX_CMDLINE + 64];
+        int len = snprintf(header, sizeof(header), "P6\n# %s\n%d %d\n255\n",
+                           cmdline, task->width, task->height);
+        return writer_put(fd, header, (size_t)len);
+    }
+    if (wr->format == FORMAT_RAW) {
+        RawHeader hdr;
+        raw_header(&hdr, task, wr->sub == 2, origin_re, origin_im);
+        return writer_put(fd, &hdr, sizeof(hdr));
+    }
+    return 0;
+}
+
+/* Pixels of iteration rows, 3 bytes each */
+static uint8_t *rgb_rows(const Writer *wr, uint8_t *p, const IterCount *it, size_t pixels) {
+    const int top = max_iter;
+    for (size_t i = 0; i < pixels; i++) {
+        memcpy(p, wr->rgb[it[i] < top ? it[i] : top], 3);
+        p += 3;
+    }
+    return p;
+}
+
+/*
+ * The bytes of h pixel rows starting at it (h a multiple of sub unless the
+ * image ends there), at p; returns the end. cells is text formats' scratch,
+ * enough for the rows. For PNG, *adler is carried on over the scanlines.
+ */
+static char *writer_format(const Writer *wr, char *p, Cell *cells, const IterCount *it,
+                           int h, uint32_t *adler) {
+    const int w = wr->w, top = max_iter;
+    size_t pixels = (size_t)w * h;
+    
+    switch (wr->format) {
+    case FORMAT_RAW:
+        memcpy(p, it, pixels * sizeof(IterCount));
+        return p + pixels * sizeof(IterCount);
+        
+    case FORMAT_PPM:
+        return (char *)rgb_rows(wr, (uint8_t *)p, it, pixels);
+        
+    case FORMAT_PNG: {
+        /*
+         * Scanlines (filter byte 0, then the pixels) are laid out behind
+         * room for every block header, then moved down block by block
+         * to open the gaps for the headers.
+         */
+        size_t line = (size_t)w * 3 + 1, raw = line * h;
+        size_t blocks = (raw + PNG_BLOCK - 1) / PNG_BLOCK;
+        uint8_t *chunk = (uint8_t *)p, *data = chunk + 8 + blocks * 5;
+        for (int y = 0; y < h; y++) {
+            data[y * line] = 0;
+            rgb_rows(wr, data + y * line + 1, it + (size_t)y * w, (size_t)w);
+        }
+        *adler = adler32_update(*adler, data, raw);
+        
+        uint8_t *q = chunk + 8;
+        for (size_t b = 0; b < blocks; b++) {
+            size_t len = raw - b * PNG_BLOCK < PNG_BLOCK ? raw - b * PNG_BLOCK : PNG_BLOCK;
+            memmove(q + 5, data + b * PNG_BLOCK, len);
+            q[0] = 0;                                 /* Stored, not final */
+            q[1] = (uint8_t)len; q[2] = (uint8_t)(len >> 8);
+            q[3] = (uint8_t)~len; q[4] = (uint8_t)(~len >> 8);
+            q += 5 + len;
+        }
+        put_be32(chunk, (uint32_t)(q - chunk - 8));
+        memcpy(chunk + 4, "IDAT", 4);
+        q = put_be32(q, crc32_update(0, chunk + 4, (size_t)(q - chunk - 4)));
+        return (char *)q;
+    }
+        
+    case FORMAT_PLAIN:
+        for (int y = 0; y < h; y += wr->sub) {
+            const IterCount *row = it + (size_t)y * w;
+            if (wr->sub == 2) {
+                /* Both halves' counts averaged into one character */
+                const IterCount *below = y + 1 < h ? row + w : row;
+                for (int x = 0; x < w; x++) {
+                    int n = (row[x] + below[x]) / 2;
+                    *p++ = wr->glyphs[n < top ? n : top];
+                }
+            } else {
+                for (int x = 0; x < w; x++) *p++ = wr->glyphs[row[x] < top ? row[x] : top];
+            }
+            *p++ = '\n';
+        }
+        return p;
+        
+    default: {
+        int rows = (h + wr->sub - 1) / wr->sub;
+        if (wr->sub == 2) {
+            cells_halfblock(cells, it, w, h, 0, rows);
+        } else {
+            cells_ascii(cells, it, w, 0, rows);
+        }
+        return emit_full(p, cells, w, 0, rows);
+    }
+    }
+}
+
+/* Write h pixel rows (at most one band) starting at it */
+static int writer_rows(Writer *wr, int fd, const IterCount *it, int h) {
+    if (wr->format == FORMAT_RAW)
+        return writer_put(fd, it, (size_t)wr->w * h * sizeof(IterCount));
+    char *p = writer_format(wr, wr->out.buf, wr->cells, it, h, &wr->adler);
+    return writer_put(fd, wr->out.buf, (size_t)(p - wr->out.buf));
+}
+
+/* PNG: the end of the zlib stream (empty final block, Adler-32) and IEND */
+static size_t writer_trailer_bytes(const Writer *wr, uint32_t adler, uint8_t *out) {
+    if (wr->format != FORMAT_PNG) return 0;
+    uint8_t end[9] = { 1, 0, 0, 0xFF, 0xFF };
+    put_be32(end + 5, adler);
+    uint8_t *p = png_chunk(out, "IDAT", end, sizeof(end));
+    return (size_t)(png_chunk(p, "IEND", "", 0) - out);
+}
+
+static int writer_trailer(const Writer *wr, int fd) {
+    uint8_t trailer[64];
+    size_t n = writer_trailer_bytes(wr, wr->adler, trailer);
+    return n ? writer_put(fd, trailer, n) : 0;
+}
+
+/* Set up frame_job for pixel rows row0 .. row0 + h - 1 of the output */
+static int poster_band(IterCount *out, int w, int h, int row0) {
+    FrameJob *job = &frame_job;
+    if (view_task(&job->task, w, h, row0, out) != 0) return -1;
+    job_whole(job);
+    plan_mirror(job);
+    if (job->mirror.x0 < job->mirror.x1) prepare_frame_job(job);   /* Renumber the cut */
+    return 0;
+}
+
+/*
+ * Write the current view to fd in output_path's format: frame, fw x fh,
+ * if it is already computed, else computed band by band.
+ */
+static int write_poster(int fd, const IterCount *frame, int fw, int fh) {
+    int format = output_format(output_path);
+    int w, h;                                     /* Iteration grid */
+    
+    if (frame) {
+        w = fw;
+        h = fh;
+    } else {
+        if (!poster_w || !poster_h) {
+            update_term_size();
+            if (!poster_w) poster_w = term_w;
+            if (!poster_h) poster_h = term_h;
+        }
+        w = poster_w;
+        h = use_halfblock ? poster_h * 2 : poster_h;
+        update_view_origin(w, h);
+        snap_viewport_to_grid(w, h);
+    }
+    
+    Writer wr;
+    IterCount *bufs[2] = { NULL, NULL };
+    WorkerTask task;
+    int status = -1;
+    
+    int err = writer_init(&wr, format, w, h);
+    size_t band_pixels = (size_t)w * wr.band;
+    if (!frame) {
+        bufs[0] = malloc(band_pixels * sizeof(IterCount));
+        bufs[1] = malloc(band_pixels * sizeof(IterCount));
+        if (!bufs[0] || !bufs[1]) err = -1;
+        for (int i = 0; i < 2 && !err; i++)
+            pool_first_touch(bufs[i], band_pixels * sizeof(IterCount));
+    }
+    if (err || view_task(&task, w, h, 0, NULL) != 0) {
+        fprintf(stderr, "Error: out of memory\n");
+        goto done;
+    }
+    if (writer_header(&wr, fd, &task, &view_origin_re, &view_origin_im) != 0) goto write_error;
+    
+    if (!frame) {
+        if (poster_band(bufs[0], w, wr.band, 0) != 0) goto done;
+        pool_run(run_frame_job, &frame_job);
+        apply_mirror(&frame_job);
+    }
+    
+    for (int y0 = 0, k = 0; y0 < h; y0 += wr.band, k ^= 1) {
+        int y1 = y0 + wr.band < h ? y0 + wr.band : h;
+        const IterCount *it = frame ? frame + (size_t)y0 * w : bufs[k];
+        
+        /* Start the next band before formatting this one */
+        int next = !frame && y1 < h;
+        if (next) {
+            int n = (y1 + wr.band < h ? y1 + wr.band : h) - y1;
+            if (poster_band(bufs[k ^ 1], w, n, y1) != 0) goto done;
+            pool_submit(run_frame_job, &frame_job);
+        }
+        
+        err = writer_rows(&wr, fd, it, y1 - y0);
+        
+        if (next) {
+            pool_wait();
+            apply_mirror(&frame_job);
+        }
+        if (err) goto write_error;
+    }
+    if (writer_trailer(&wr, fd) != 0) goto write_error;
+    status = 0;
+    goto done;
+    
+write_error:
+    perror(output_path ? output_path : "write");
+done:
+    writer_free(&wr);
+    free(bufs[0]);
+    free(bufs[1]);
+    return status;
+}
+
+static int render_poster(void) {
+    int fd = STDOUT_FILENO;
+    if (output_path) {
+        fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            perror(output_path);
+            return -1;
+        }
+    }
+    int status = write_poster(fd, loaded_data, loaded_w, loaded_h);
+    if (output_path && close(fd) != 0 && status == 0) {
+        perror(output_path);
+        status = -1;
+    }
+    return status;
 }
 
 /* ========================================================================== */
-/*                           FILE EXPORT                                      */
+/*                           SCREEN EXPORT                                    */
 /* ========================================================================== */
 
-static void save_to_file(const int *iterations, int w, int h) {
-    if (!iterations) return;
+/*
+ * The p, P, r and i keys save the frame on screen as plain .txt, coloured
+ * .ansi (what the screen shows), .raw or .png. The frame is formatted by
+ * the offline Writer, one band of rows per worker like a screen frame,
+ * into buffers the export owns; a background thread then writes them with
+ * one writev() and reports back through export_pipe, so the keyboard is
+ * never held up by the disk. One export is in flight at a time: the next
+ * one waits for it, which also keeps its buffers free to reuse.
+ */
+typedef struct {
+    Writer wr;
+    const IterCount *iterations;
+    int w, h;
+    int rows;                     /* Writer rows: text rows, else pixel rows */
+    int segments;
+    Cell *cells;                  /* Text scratch for the whole frame */
+    size_t cells_capacity;
+    uint32_t adler[MAX_THREADS];  /* PNG: Adler-32 of each segment's scanlines */
+    size_t raw_len[MAX_THREADS];
+    OutSegment head, segs[MAX_THREADS];
+    uint8_t tail[64];
+    size_t tail_len;
+    char filename[64];
+    pthread_t thread;
+    int running;                  /* Thread started, not yet joined */
+    atomic_int finished;
+    int ok;
+} ExportJob;
+
+static ExportJob export_job;
+static int export_pipe[2] = { -1, -1 };   /* A byte per finished export */
+
+static void export_segment(void *ctx, int worker_id) {
+    ExportJob *job = ctx;
+    if (worker_id >= job->segments) return;
+    
+    int sub = job->wr.sub;
+    int r0 = (int)((long)job->rows * worker_id / job->segments);
+    int r1 = (int)((long)job->rows * (worker_id + 1) / job->segments);
+    int y0 = r0 * sub, y1 = r1 * sub < job->h ? r1 * sub : job->h;
+    OutSegment *seg = &job->segs[worker_id];
+    
+    job->adler[worker_id] = 1;
+    job->raw_len[worker_id] = ((size_t)job->w * 3 + 1) * (y1 - y0);
+    char *p = writer_format(&job->wr, seg->buf, job->cells + (size_t)r0 * job->w,
+                            job->iterations + (size_t)y0 * job->w, y1 - y0,
+                            &job->adler[worker_id]);
+    seg->len = (size_t)(p - seg->buf);
+}
+
+static void *export_thread(void *arg) {
+    ExportJob *job = arg;
+    struct iovec iov[MAX_THREADS + 2];
+    int cnt = 0;
+    iov[cnt++] = (struct iovec){ job->head.buf, job->head.len };
+    for (int i = 0; i < job->segments; i++)
+        iov[cnt++] = (struct iovec){ job->segs[i].buf, job->segs[i].len };
+    iov[cnt++] = (struct iovec){ job->tail, job->tail_len };
+    
+    int fd = open(job->filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    job->ok = fd >= 0 && safe_writev(fd, iov, cnt) == 0;
+    if (fd >= 0 && close(fd) != 0) job->ok = 0;
+    
+    atomic_store(&job->finished, 1);
+    char c = 0;
+    if (write(export_pipe[1], &c, 1) < 0) { /* Pipe full: the main loop is woken already */ }
+    return NULL;
+}
+
+static void export_report(const ExportJob *job) {
+    snprintf(status_message, MAX_STATUS_LEN, job->ok ? "Saved: %s" : "Error writing %s",
+             job->filename);
+}
+
+/* Join the export in flight, if any; the result goes to the header */
+static void export_wait(void) {
+    ExportJob *job = &export_job;
+    if (!job->running) return;
+    pthread_join(job->thread, NULL);
+    job->running = 0;
+    export_report(job);
+}
+
+/* After an export_pipe byte: collect the export if it has finished */
+static int export_poll(void) {
+    if (!export_job.running || !atomic_load(&export_job.finished)) return 0;
+    export_wait();
+    return 1;
+}
+
+/*
+ * Format iterations, w x h, as a file_format export and start writing it.
+ * task describes the grid for the PNG and raw headers.
+ */
+static void export_frame(const IterCount *iterations, int w, int h, int file_format,
+                       const char *ext, const WorkerTask *task) {
+    ExportJob *job = &export_job;
+    export_wait();
     
     time_t now = time(NULL);
     struct tm *t = localtime(&now);
-    char filename[64];
-    snprintf(filename, sizeof(filename), "marcepan_%04d%02d%02d_%02d%02d%02d.txt",
+    snprintf(job->filename, sizeof(job->filename), "marcepan_%04d%02d%02d_%02d%02d%02d.%s",
              t->tm_year + 1900, t->tm_mon + 1, t->tm_mday,
-             t->tm_hour, t->tm_min, t->tm_sec);
+             t->tm_hour, t->tm_min, t->tm_sec, ext);
     
-    FILE *f = fopen(filename, "w");
-    if (!f) return;
+    Writer *wr = &job->wr;
+    int err = writer_tables(wr, file_format, w);
+    job->iterations = iterations;
+    job->w = w;
+    job->h = h;
+    job->rows = (h + wr->sub - 1) / wr->sub;
     
-    const char *pal = palettes[current_palette];
-    int pal_len = (int)strlen(pal);
+    /* Text exports start with the command line as a comment */
+    job->head.len = 0;
+    writer_sink = &job->head;
+    if (!err && (file_format == FORMAT_TEXT || file_format == FORMAT_PLAIN)) {
+        char line[MAX_CMDLINE + 3];
+        memcpy(line, "# ", 2);
+        int n = build_cmdline(line + 2, MAX_CMDLINE) + 2;
+        line[n++] = '\n';
+        err = writer_put(-1, line, (size_t)n);
+    } else if (!err) {
+        err = writer_header(wr, -1, task, &last_origin_re, &last_origin_im);
+    }
+    writer_sink = NULL;
     
-    /* Write command line as comment */
-    char cmdline[512];
-    build_cmdline(cmdline, sizeof(cmdline));
-    fprintf(f, "# %s\n", cmdline);
+    size_t count = (size_t)w * job->rows;
+    if (!err && file_format == FORMAT_TEXT && count > job->cells_capacity) {
+        free(job->cells);
+        job->cells = malloc(count * sizeof(Cell));
+        job->cells_capacity = job->cells ? count : 0;
+        if (!job->cells) err = -1;
+    }
     
-    /* Handle half-block mode: render 2 rows into 1 using simple chars */
-    if (use_halfblock) {
-        for (int y = 0; y < h; y += 2) {
-            const int *row_top = iterations + y * w;
-            const int *row_bot = (y + 1 < h) ? iterations + (y + 1) * w : row_top;
-            for (int x = 0; x < w; x++) {
-                /* Average the two iterations for ASCII representation */
-                int avg = (row_top[x] + row_bot[x]) / 2;
-                fputc(iteration_to_char(avg, max_iter, pal, pal_len), f);
+    int inline_run = pool_busy();
+    int segments = inline_run ? 1 : pool_size();
+    if (segments > job->rows) segments = job->rows;
+    if (segments < 1) segments = 1;
+    job->segments = segments;
+    for (int i = 0; i < segments && !err; i++) {
+        int r0 = (int)((long)job->rows * i / segments);
+        int r1 = (int)((long)job->rows * (i + 1) / segments);
+        err = reserve_segment(&job->segs[i], writer_bound(wr, (r1 - r0) * wr->sub));
+    }
+    if (err) {
+        writer_free(wr);
+        snprintf(status_message, MAX_STATUS_LEN, "Out of memory, %s not saved", job->filename);
+        return;
+    }
+    
+    if (inline_run) {
+        export_segment(job, 0);
+    } else {
+        pool_run(export_segment, job);
+    }
+    
+    uint32_t adler = job->adler[0];
+    for (int i = 1; i < segments; i++)
+        adler = adler32_combine(adler, job->adler[i], job->raw_len[i]);
+    job->tail_len = writer_trailer_bytes(wr, adler, job->tail);
+    writer_free(wr);
+    
+    atomic_store(&job->finished, 0);
+    if (pthread_create(&job->thread, NULL, export_thread, job) == 0) {
+        job->running = 1;
+        snprintf(status_message, MAX_STATUS_LEN, "Saving %s", job->filename);
+    } else {
+        export_thread(job);           /* Write it on this thread instead */
+        export_report(job);
+    }
+}
+
+static void save_to_file(const IterCount *iterations, int w, int h) {
+    if (iterations) export_frame(iterations, w, h, FORMAT_PLAIN, "txt", NULL);
+}
+
+static void save_to_file_colored(const IterCount *iterations, int w, int h) {
+    if (iterations) export_frame(iterations, w, h, FORMAT_TEXT, "ansi", NULL);
+}
+
+/* One pixel per iteration value, every row of a half-block frame included */
+static void save_png(const IterCount *iterations, int w, int h) {
+    WorkerTask task = { .width = w, .height = h };
+    if (iterations) export_frame(iterations, w, h, FORMAT_PNG, "png", &task);
+}
+
+/* Only a finished frame is saved: its grid is last_task's */
+static void save_raw(const IterCount *iterations) {
+    if (!iterations || last_task.output != iterations) {
+        snprintf(status_message, MAX_STATUS_LEN, "Frame not complete, not saved");
+        return;
+    }
+    export_frame(iterations, last_task.width, last_task.height, FORMAT_RAW, "raw", &last_task);
+}
+
+/*
+ * The save keys as bits. A save pressed after a view change, or while the
+ * frame of a new view is being computed, waits for that frame: the file is
+ * labelled with the current view and depth, and the frame on screen
+ * still shows the old ones.
+ */
+enum { SAVE_TXT = 1, SAVE_ANSI = 2, SAVE_RAW = 4, SAVE_PNG = 8 };
+
+static void save_frame(int saves, const IterCount *iterations, int w, int h) {
+    if (saves & SAVE_TXT) save_to_file(iterations, w, h);
+    if (saves & SAVE_ANSI) save_to_file_colored(iterations, w, h);
+    if (saves & SAVE_RAW) save_raw(iterations);
+    if (saves & SAVE_PNG) save_png(iterations, w, h);
+}
+
+/* Free the buffers kept between exports, once the last one is written */
+static void export_free(void) {
+    ExportJob *job = &export_job;
+    export_wait();
+    free(job->cells);
+    free(job->head.buf);
+    for (int i = 0; i < MAX_THREADS; i++) free(job->segs[i].buf);
+}
+
+/* ========================================================================== */
+/*                            ANIMATION                                       */
+/* ========================================================================== */
+
+/*
+ * Zoom animation (--frames N --zoom-to RE IM W): N frames from the start
+ * view to a view W wide around the target, the height in proportion. The
+ * size shrinks geometrically and the center moves so that the target
+ * drifts steadily to the middle of the screen instead of leaving it.
+ *
+ * Frames go through the same pipeline as interactive mode: frame i + 1
+ * is set up and computed on the pool while this thread writes frame i,
+ * and setup_frame() reuses whatever the grid allows, so a pure pan only
+ * computes the strips it exposes and a repeated view comes from the tile
+ * cache. Each frame is written in bands like an offline render.
+ */
+typedef struct {
+    BigFix target_re, target_im;
+    double dre, dim;              /* Start center minus target */
+    double w0, h0, w1;            /* Start size, target width */
+} Animation;
+
+/* Take the view of frame i */
+static void anim_view(const Animation *a, int i) {
+    double t = anim_frames > 1 ? (double)i / (anim_frames - 1) : 0;
+    double scale = pow(a->w1 / a->w0, t);
+    double k = a->w0 != a->w1 ? (a->w0 * scale - a->w1) / (a->w0 - a->w1) : 1 - t;
+    double hw = a->w0 * scale / 2, hh = a->h0 * scale / 2;
+    
+    /* The viewport is kept relative to the target; update_view_origin() folds it back */
+    if (memcmp(&view_origin_re, &a->target_re, sizeof(BigFix)) ||
+        memcmp(&view_origin_im, &a->target_im, sizeof(BigFix))) {
+        view_origin_re = a->target_re;
+        view_origin_im = a->target_im;
+        deep_orbit.max_iter = 0;
+    }
+    view_xmin = a->dre * k - hw; view_xmax = a->dre * k + hw;
+    view_ymin = a->dim * k - hh; view_ymax = a->dim * k + hh;
+}
+
+/*
+ * A printf pattern with exactly one integer conversion (%d, %04d, ...),
+ * its width at most FRAME_WIDTH_DIGITS digits long
+ */
+#define FRAME_WIDTH_DIGITS 3
+
+static int frame_pattern_ok(const char *s) {
+    int conversions = 0;
+    for (; *s; s++) {
+        if (*s != '%') continue;
+        if (s[1] == '%') { s++; continue; }
+        s++;
+        int digits = 0;
+        while (*s >= '0' && *s <= '9' && digits++ < FRAME_WIDTH_DIGITS) s++;
+        if (*s != 'd') return 0;
+        conversions++;
+    }
+    return conversions == 1;
+}
+
+static int render_animation(void) {
+    Animation a;
+    BigFix t, c;
+    a.target_re = anim_re;
+    a.target_im = anim_im;
+    big_from_double(&t, (view_xmin + view_xmax) / 2);
+    big_add(&c, &view_origin_re, &t);
+    big_sub(&c, &c, &anim_re);
+    a.dre = big_to_double(&c);
+    big_from_double(&t, (view_ymin + view_ymax) / 2);
+    big_add(&c, &view_origin_im, &t);
+    big_sub(&c, &c, &anim_im);
+    a.dim = big_to_double(&c);
+    a.w0 = view_xmax - view_xmin;
+    a.h0 = view_ymax - view_ymin;
+    a.w1 = anim_width;
+    
+    int w, h;
+    frame_size(&w, &h);
+    if (!julia_mode && (a.w1 / w < DEEP_MIN_SPACING || a.h0 * a.w1 / a.w0 / h < DEEP_MIN_SPACING)) {
+        fprintf(stderr, "Error: --zoom-to size is past the zoom limit\n");
+        return -1;
+    }
+    
+    Writer wr;
+    if (writer_init(&wr, output_format(output_path), w, h) != 0) {
+        fprintf(stderr, "Error: out of memory\n");
+        writer_free(&wr);
+        return -1;
+    }
+    
+    IterCount *shown = NULL, *pending;
+    int status = -1;
+    anim_view(&a, 0);
+    pending = start_frame(NULL, &w, &h);
+    
+    for (int i = 0; i < anim_frames; i++) {
+        if (!pending) {
+            fprintf(stderr, "Error: out of memory\n");
+            goto done;
+        }
+        finish_frame();
+        iter_buffer_put(shown);
+        shown = pending;
+        pending = NULL;
+        
+        char path[4096];
+        int fd = STDOUT_FILENO;
+        if (output_path) {
+            int n = snprintf(path, sizeof(path), output_path, i);
+            if (n < 0 || n >= (int)sizeof(path)) {
+                fprintf(stderr, "Error: frame name from %s is too long\n", output_path);
+                goto done;
+            }
+            if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+                perror(path);
+                goto done;
             }
-            fputc('\n', f);
         }
-    } else {
-        for (int row = 0; row < h; row++) {
-            for (int col = 0; col < w; col++)
-                fputc(iteration_to_char(iterations[row * w + col], max_iter, pal, pal_len), f);
-            fputc('\n', f);
+        
+        /* The header still describes this frame; then the next one starts */
+        int err = writer_header(&wr, fd, &last_task, &view_origin_re, &view_origin_im);
+        int fw = w, fh = h;
+        if (i + 1 < anim_frames) {
+            anim_view(&a, i + 1);
+            pending = start_frame(shown, &w, &h);
+        }
+        for (int y0 = 0; y0 < fh && !err; y0 += wr.band)
+            err = writer_rows(&wr, fd, shown + (size_t)y0 * fw,
+                              y0 + wr.band < fh ? wr.band : fh - y0);
+        if (!err) err = writer_trailer(&wr, fd);
+        
+        if (output_path && close(fd) != 0) err = -1;
+        if (err) {
+            perror(output_path ? path : "write");
+            goto done;
         }
     }
+    status = 0;
     
-    fclose(f);
-    snprintf(status_message, MAX_STATUS_LEN, "Saved: %s", filename);
+done:
+    if (pending) pool_wait();
+    iter_buffer_put(pending);
+    iter_buffer_put(shown);
+    writer_free(&wr);
+    return status;
+}
+
+/* ========================================================================== */
+/*                             BENCHMARK                                      */
+/* ========================================================================== */
+
+/*
+ * --bench renders a fixed set of views headless, BENCH_W x BENCH_H cells
+ * unless -W/-H say otherwise, and reports the best of BENCH_RUNS runs of
+ * each. The tile cache and frame reuse are off, so no run reuses an
+ * earlier one; threads, kernel, scheduler, -ms and --no-interior apply as
+ * given, which is what makes runs comparable across builds and flags.
+ * Symmetry mirroring stays on, as in any frame: "full" and "julia"
+ * straddle the axis and compute only about half their rows.
+ *
+ * Iterations are the sum of the counts (max_iter for points in the set),
+ * the work a plain escape-time loop would do over the whole frame;
+ * interior shortcuts and mirrored rows show up as a higher rate.
+ * Serialization is render_frame() into /dev/null.
+ */
+#define BENCH_W     800
+#define BENCH_H     250
+#define BENCH_RUNS  3
+
+typedef struct {
+    const char *name;
+    const char *re, *im;          /* Center, any number of digits */
+    double width, height;
+    int max_iter;
+    int julia_mode, halfblock;
+    double julia_cr, julia_ci;
+} BenchView;
+
+static const BenchView bench_views[] = {
+    { "full",      "-0.5", "0", 3.0, 2.0, 256, 0, 0, 0, 0 },
+    { "seahorse",  "-0.7435", "0.1314", 0.012, 0.008, 1000, 0, 0, 0, 0 },
+    { "interior",  "-0.1225", "0.7449", 0.003, 0.002, 5000, 0, 0, 0, 0 },
+    { "julia",     "0", "0", 3.2, 2.0, 500, 1, 0, -0.7, 0.27015 },
+    { "halfblock", "-0.7435", "0.1314", 0.012, 0.008, 1000, 0, 1, 0, 0 },
+    { "deep",      "-0.743643887037158704752191506114774",
+                   "0.131825904205311970493132056385139",
+                   1e-20, 6.666666666666667e-21, 10000, 0, 0, 0, 0 },
+};
+#define BENCH_VIEW_COUNT (sizeof(bench_views) / sizeof(bench_views[0]))
+
+typedef struct {
+    int w, h;                     /* Iteration grid */
+    double wall_ms;
+    double iterations;
+    double busy_ms[MAX_THREADS];
+    double serialize_ms;
+    size_t bytes;
+    const char *precision;        /* Tier the view ran in, "deep" for perturbation */
+} BenchResult;
+
+static void bench_view(const BenchView *v) {
+    big_parse(&view_origin_re, v->re);
+    big_parse(&view_origin_im, v->im);
+    deep_orbit.max_iter = 0;
+    view_xmin = -v->width / 2; view_xmax = v->width / 2;
+    view_ymin = -v->height / 2; view_ymax = v->height / 2;
+    max_iter = v->max_iter;
+    julia_mode = v->julia_mode;
+    julia_cr = v->julia_cr; julia_ci = v->julia_ci;
+    use_halfblock = v->halfblock;
 }
 
-static void save_to_file_colored(const int *iterations, int w, int h) {
-    if (!iterations) return;
+static int bench_run(BenchResult *r, IterCount **buffer) {
+    last_task.output = NULL;      /* Compute everything, reuse nothing */
     
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    char filename[64];
-    snprintf(filename, sizeof(filename), "marcepan_%04d%02d%02d_%02d%02d%02d.ansi",
-             t->tm_year + 1900, t->tm_mon + 1, t->tm_mday,
-             t->tm_hour, t->tm_min, t->tm_sec);
+    double t0 = now_ms();
+    if (compute_fractal(buffer, &r->w, &r->h) != 0) return -1;
+    double t1 = now_ms();
+    render_frame(*buffer, r->w, r->h);
+    double t2 = now_ms();
     
-    FILE *f = fopen(filename, "w");
-    if (!f) return;
+    r->wall_ms = t1 - t0;
+    r->serialize_ms = t2 - t1;
+    r->bytes = render_job.bytes;
+    memcpy(r->busy_ms, frame_job.busy_ms, sizeof(r->busy_ms));
+    r->precision = frame_job.task.deep ? "deep" : precision_names[frame_job.task.precision];
+    r->iterations = 0;
+    for (size_t i = 0; i < (size_t)r->w * r->h; i++)
+        r->iterations += (*buffer)[i] < max_iter ? (*buffer)[i] : max_iter;
+    return 0;
+}
+
+static void busy_stats(const BenchResult *r, int n, double *lo, double *mean, double *hi) {
+    *lo = *hi = r->busy_ms[0];
+    *mean = 0;
+    for (int i = 0; i < n; i++) {
+        if (r->busy_ms[i] < *lo) *lo = r->busy_ms[i];
+        if (r->busy_ms[i] > *hi) *hi = r->busy_ms[i];
+        *mean += r->busy_ms[i] / n;
+    }
+}
+
+static int run_bench(const char *report_path) {
+    FILE *report = NULL;
+    int json = 0;
+    if (report_path) {
+        json = has_suffix(report_path, ".json");
+        if (!json && !has_suffix(report_path, ".csv")) {
+            fprintf(stderr, "Error: --bench-out needs a .csv or .json file name\n");
+            return -1;
+        }
+        report = fopen(report_path, "w");
+        if (!report) {
+            perror(report_path);
+            return -1;
+        }
+    }
     
-    const char *pal = palettes[current_palette];
-    int pal_len = (int)strlen(pal);
-    const uint8_t *colors = color_schemes[current_color_scheme];
+    render_fd = open("/dev/null", O_WRONLY);
+    if (render_fd < 0) {
+        perror("/dev/null");
+        if (report) fclose(report);
+        return -1;
+    }
+    if (!poster_w) poster_w = BENCH_W;
+    if (!poster_h) poster_h = BENCH_H;
+    int threads = pool_size();
     
-    /* Write command line as comment */
-    char cmdline[512];
-    build_cmdline(cmdline, sizeof(cmdline));
-    fprintf(f, "# %s\n", cmdline);
+    printf("marcepan bench: %dx%d cells, %s backend, %d thread%s%s%s, kernel %s, scheduler %s%s%s, "
+           "best of %d\n\n", poster_w, poster_h, active_backend->name,
+           threads, threads == 1 ? "" : "s", affinity_mode ? " pinned " : "",
+           affinity_mode ? affinity_names[affinity_mode] : "", active_kernel->name,
+           sched_names[sched_mode], solid_guess ? ", -ms" : "",
+           interior_check ? "" : ", --no-interior", BENCH_RUNS);
+    printf("%-10s %-6s %9s %9s %8s %9s %24s %8s %9s\n", "view", "prec", "pixels", "wall ms",
+           "Mpix/s", "Miter/s", "busy ms min/mean/max", "ser ms", "ser KiB");
     
-    if (use_halfblock) {
-        /* Half-block colored output */
-        for (int y = 0; y < h; y += 2) {
-            const int *row_top = iterations + y * w;
-            const int *row_bot = (y + 1 < h) ? iterations + (y + 1) * w : row_top;
-            
-            for (int x = 0; x < w; x++) {
-                int n_top = row_top[x];
-                int n_bot = row_bot[x];
-                int c_top = iteration_to_color(n_top, max_iter, colors);
-                int c_bot = iteration_to_color(n_bot, max_iter, colors);
-                
-                if (n_top >= max_iter && n_bot >= max_iter) {
-                    fputc(' ', f);
-                } else if (c_top == c_bot) {
-                    if (n_top >= max_iter) {
-                        fprintf(f, "\x1b[38;5;%dm▄", c_bot);
-                    } else if (n_bot >= max_iter) {
-                        fprintf(f, "\x1b[38;5;%dm▀", c_top);
-                    } else {
-                        fprintf(f, "\x1b[38;5;%dm█", c_top);
-                    }
-                } else {
-                    fprintf(f, "\x1b[38;5;%d;48;5;%dm▀", c_top, c_bot);
-                }
+    if (report && json) {
+        fprintf(report, "{\n  \"width\": %d, \"height\": %d, \"backend\": \"%s\", \"threads\": %d,\n"
+                        "  \"affinity\": \"%s\", \"kernel\": \"%s\", \"scheduler\": \"%s\",\n"
+                        "  \"solid_guess\": %d, \"interior_check\": %d, \"runs\": %d,\n"
+                        "  \"views\": [",
+                poster_w, poster_h, active_backend->name, threads,
+                affinity_names[affinity_mode], active_kernel->name, sched_names[sched_mode],
+                solid_guess, interior_check, BENCH_RUNS);
+    } else if (report) {
+        fprintf(report, "view,width,height,max_iter,backend,threads,kernel,scheduler,precision,"
+                        "pixels,wall_ms,"
+                        "mpix_per_s,iterations,miter_per_s,busy_min_ms,busy_mean_ms,"
+                        "busy_max_ms,serialize_ms,serialize_bytes\n");
+    }
+    
+    IterCount *buffer = NULL;
+    int status = 0;
+    for (size_t k = 0; k < BENCH_VIEW_COUNT; k++) {
+        const BenchView *v = &bench_views[k];
+        BenchResult best, r;
+        bench_view(v);
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            if (bench_run(&r, &buffer) != 0) {
+                fprintf(stderr, "Error: out of memory\n");
+                status = -1;
+                goto done;
             }
-            fprintf(f, "\x1b[0m\n");
+            if (run == 0 || r.wall_ms < best.wall_ms) best = r;
         }
-    } else {
-        /* Standard colored output */
-        int last_color = -1;
-        for (int row = 0; row < h; row++) {
-            for (int col = 0; col < w; col++) {
-                int n = iterations[row * w + col];
-                char ch = iteration_to_char(n, max_iter, pal, pal_len);
-                
-                if (ch != FILL_CHAR) {
-                    int color = iteration_to_color(n, max_iter, colors);
-                    if (color != last_color) {
-                        fprintf(f, "\x1b[38;5;%dm", color);
-                        last_color = color;
-                    }
-                } else if (last_color != -1) {
-                    fprintf(f, "\x1b[0m");
-                    last_color = -1;
-                }
-                fputc(ch, f);
-            }
-            if (last_color != -1) {
-                fprintf(f, "\x1b[0m");
-                last_color = -1;
-            }
-            fputc('\n', f);
+        
+        double pixels = (double)best.w * best.h;
+        double mpix = pixels / best.wall_ms / 1e3;
+        double miter = best.iterations / best.wall_ms / 1e3;
+        double lo, mean, hi;
+        busy_stats(&best, threads, &lo, &mean, &hi);
+        printf("%-10s %-6s %9.0f %9.2f %8.2f %9.1f %8.2f/%7.2f/%7.2f %8.2f %9.1f\n",
+               v->name, best.precision, pixels, best.wall_ms, mpix, miter, lo, mean, hi,
+               best.serialize_ms, best.bytes / 1024.0);
+        
+        if (report && json) {
+            fprintf(report, "%s\n    { \"view\": \"%s\", \"max_iter\": %d, \"precision\": \"%s\","
+                            " \"pixels\": %.0f,"
+                            " \"wall_ms\": %.3f, \"mpix_per_s\": %.3f,\n"
+                            "      \"iterations\": %.0f, \"miter_per_s\": %.3f,"
+                            " \"serialize_ms\": %.3f, \"serialize_bytes\": %zu,\n"
+                            "      \"busy_ms\": [",
+                    k ? "," : "", v->name, v->max_iter, best.precision, pixels, best.wall_ms, mpix,
+                    best.iterations, miter, best.serialize_ms, best.bytes);
+            for (int i = 0; i < threads; i++)
+                fprintf(report, "%s%.3f", i ? ", " : "", best.busy_ms[i]);
+            fprintf(report, "] }");
+        } else if (report) {
+            fprintf(report, "%s,%d,%d,%d,%s,%d,%s,%s,%s,%.0f,%.3f,%.3f,%.0f,%.3f,%.3f,%.3f,%.3f,"
+                            "%.3f,%zu\n",
+                    v->name, best.w, best.h, v->max_iter, active_backend->name, threads,
+                    active_kernel->name,
+                    sched_names[sched_mode], best.precision, pixels, best.wall_ms, mpix, best.iterations,
+                    miter, lo, mean, hi, best.serialize_ms, best.bytes);
         }
     }
+    if (report && json) fprintf(report, "\n  ]\n}\n");
     
-    fclose(f);
-    snprintf(status_message, MAX_STATUS_LEN, "Saved: %s", filename);
+done:
+    iter_buffer_put(buffer);
+    close(render_fd);
+    render_fd = STDOUT_FILENO;
+    if (report && fclose(report) != 0 && status == 0) {
+        perror(report_path);
+        status = -1;
+    }
+    return status;
 }
 
 /* ========================================================================== */
@@ -680,7 +6196,19 @@ static void pan_view(double dx_frac, double dy_frac) {
     view_ymin += dy; view_ymax += dy;
 }
 
+/* Refuse zooming past what the deep-zoom fixed point can resolve */
+static int zoom_limited(double new_width, double new_height) {
+    int w, h;
+    frame_size(&w, &h);                  /* The pixel grid setup_frame() computes */
+    if (julia_mode || (new_width / w >= DEEP_MIN_SPACING && new_height / h >= DEEP_MIN_SPACING))
+        return 0;
+    snprintf(status_message, MAX_STATUS_LEN, "Zoom limit reached");
+    return 1;
+}
+
 static void zoom_view(double factor) {
+    if (zoom_limited((view_xmax - view_xmin) * factor, (view_ymax - view_ymin) * factor))
+        return;
     double cx = (view_xmin + view_xmax) / 2;
     double cy = (view_ymin + view_ymax) / 2;
     double hw = (view_xmax - view_xmin) * factor / 2;
@@ -690,18 +6218,41 @@ static void zoom_view(double factor) {
 }
 
 static void zoom_x_axis(double factor) {
+    if (zoom_limited((view_xmax - view_xmin) * factor, view_ymax - view_ymin)) return;
     double cx = (view_xmin + view_xmax) / 2;
     double hw = (view_xmax - view_xmin) * factor / 2;
     view_xmin = cx - hw; view_xmax = cx + hw;
 }
 
-static void zoom_y_axis(double factor) {
+static void zoom_y_axis(double factor) {
+    if (zoom_limited(view_xmax - view_xmin, (view_ymax - view_ymin) * factor)) return;
+    double cy = (view_ymin + view_ymax) / 2;
+    double hh = (view_ymax - view_ymin) * factor / 2;
+    view_ymin = cy - hh; view_ymax = cy + hh;
+}
+
+/*
+ * Follow a terminal resize with the same pixel spacing and view center:
+ * the view gains or loses area at its edges, so the frame on screen stays
+ * on the grid and setup_frame() only computes the new margins.
+ */
+static void resize_view(void) {
+    int w0, h0, w1, h1;
+    frame_size(&w0, &h0);
+    update_term_size();
+    frame_size(&w1, &h1);
+    if (w1 == w0 && h1 == h0) return;
+    
+    double cx = (view_xmin + view_xmax) / 2;
     double cy = (view_ymin + view_ymax) / 2;
-    double hh = (view_ymax - view_ymin) * factor / 2;
+    double hw = (view_xmax - view_xmin) / w0 * w1 / 2;
+    double hh = (view_ymax - view_ymin) / h0 * h1 / 2;
+    view_xmin = cx - hw; view_xmax = cx + hw;
     view_ymin = cy - hh; view_ymax = cy + hh;
 }
 
 static void reset_view(void) {
+    clear_view_origin();
     view_xmin = -2.0; view_xmax = 1.0;
     view_ymin = -1.0; view_ymax = 1.0;
     max_iter = 30;
@@ -709,6 +6260,7 @@ static void reset_view(void) {
 }
 
 static void toggle_julia(void) {
+    clear_view_origin();
     if (!julia_mode) {
         /* Switch to Julia: use current center as the constant c */
         julia_cr = (view_xmin + view_xmax) / 2;
@@ -736,17 +6288,98 @@ static void cycle_value(int *value, int count, int delta) {
 /*                          INPUT HANDLING                                    */
 /* ========================================================================== */
 
-static int read_key(void) {
+enum { EVENT_KEY = 1, EVENT_FRAME = 2, EVENT_RESIZE = 4, EVENT_EXPORT = 8 };
+
+/* SIGWINCH writes a byte here, so that a resize wakes wait_for_event() */
+static int winch_pipe[2] = { -1, -1 };
+
+static void on_winch(int sig) {
+    (void)sig;
+    int saved = errno;
+    char c = 0;
+    if (write(winch_pipe[1], &c, 1) < 0) { /* Pipe full: a resize is noted already */ }
+    errno = saved;
+}
+
+/*
+ * Block until a key arrives, the terminal is resized, an export has been
+ * written or the pool reports a finished computation on notify_fd. Returns
+ * a mask of EVENT_* bits; the bytes of the pipes are consumed here, keys
+ * are left for read_key().
+ */
+static int wait_for_event(int notify_fd) {
     fd_set fds;
-    struct timeval tv = {0, 10000};
     FD_ZERO(&fds);
     FD_SET(STDIN_FILENO, &fds);
+    FD_SET(notify_fd, &fds);
+    int maxfd = notify_fd > STDIN_FILENO ? notify_fd : STDIN_FILENO;
+    if (winch_pipe[0] >= 0) {
+        FD_SET(winch_pipe[0], &fds);
+        if (winch_pipe[0] > maxfd) maxfd = winch_pipe[0];
+    }
+    if (export_pipe[0] >= 0) {
+        FD_SET(export_pipe[0], &fds);
+        if (export_pipe[0] > maxfd) maxfd = export_pipe[0];
+    }
     
-    if (select(STDIN_FILENO + 1, &fds, NULL, NULL, &tv) <= 0)
-        return KEY_NONE;
+    if (select(maxfd + 1, &fds, NULL, NULL, NULL) <= 0) return 0;
     
-    char c;
-    if (read(STDIN_FILENO, &c, 1) != 1) return KEY_NONE;
+    int events = 0;
+    if (FD_ISSET(STDIN_FILENO, &fds)) events |= EVENT_KEY;
+    if (FD_ISSET(notify_fd, &fds)) {
+        char c;
+        if (read(notify_fd, &c, 1) == 1) events |= EVENT_FRAME;
+    }
+    if (winch_pipe[0] >= 0 && FD_ISSET(winch_pipe[0], &fds)) {
+        char c[16];
+        while (read(winch_pipe[0], c, sizeof(c)) > 0) events |= EVENT_RESIZE;
+    }
+    if (export_pipe[0] >= 0 && FD_ISSET(export_pipe[0], &fds)) {
+        char c[16];
+        while (read(export_pipe[0], c, sizeof(c)) > 0) events |= EVENT_EXPORT;
+    }
+    return events;
+}
+
+/*
+ * Keyboard bytes, read in whole chunks: a held key or a pasted run of keys
+ * arrives as many bytes at once, and the main loop decodes and applies all
+ * of them before it starts the next frame.
+ */
+static struct {
+    unsigned char data[256];
+    int head, tail;
+} input_buf;
+
+/* Next input byte, waiting up to usec for one; -1 if none came */
+static int input_byte(long usec) {
+    if (input_buf.head == input_buf.tail) {
+        fd_set fds;
+        struct timeval tv = {0, usec};
+        FD_ZERO(&fds);
+        FD_SET(STDIN_FILENO, &fds);
+        if (select(STDIN_FILENO + 1, &fds, NULL, NULL, &tv) <= 0) return -1;
+        ssize_t n = read(STDIN_FILENO, input_buf.data, sizeof(input_buf.data));
+        if (n <= 0) return -1;
+        input_buf.head = 0;
+        input_buf.tail = (int)n;
+    }
+    return input_buf.data[input_buf.head++];
+}
+
+/* Whether a byte is buffered or can be read without blocking */
+static int input_pending(void) {
+    if (input_buf.head != input_buf.tail) return 1;
+    fd_set fds;
+    struct timeval tv = {0, 0};
+    FD_ZERO(&fds);
+    FD_SET(STDIN_FILENO, &fds);
+    return select(STDIN_FILENO + 1, &fds, NULL, NULL, &tv) > 0;
+}
+
+static int read_key(void) {
+    int c = input_byte(10000);
+    if (c < 0) return KEY_NONE;
     
     switch (c) {
         case 'q': case 'Q': return 'q';
@@ -756,6 +6389,9 @@ static int read_key(void) {
         case 'h': case 'H': return 'h';
         case 'p': return 'p';
         case 'P': return 'P';
+        case 'r': case 'R': return 'r';
+        case 'i': case 'I': return 'i';
+        case 's': case 'S': return 's';
         case '1': return '1';
         case '2': return '2';
         case '+': return KEY_PLUS;
@@ -767,22 +6403,14 @@ static int read_key(void) {
     
     if (c != '\x1b') return KEY_NONE;
     
-    tv = (struct timeval){0, 2000};
-    FD_ZERO(&fds);
-    FD_SET(STDIN_FILENO, &fds);
-    if (select(STDIN_FILENO + 1, &fds, NULL, NULL, &tv) <= 0)
-        return KEY_ESC;
-    
     char seq[8] = {0};
     int len = 0;
     
+    /* 2 ms for the first byte after ESC, 1 ms for the rest */
     while (len < 7) {
-        tv = (struct timeval){0, 1000};
-        FD_ZERO(&fds);
-        FD_SET(STDIN_FILENO, &fds);
-        if (select(STDIN_FILENO + 1, &fds, NULL, NULL, &tv) <= 0) break;
-        if (read(STDIN_FILENO, &seq[len], 1) != 1) break;
-        len++;
+        int b = input_byte(len ? 1000 : 2000);
+        if (b < 0) break;
+        seq[len++] = (char)b;
         if (len >= 2) {
             if (seq[0] == '[' && seq[len-1] >= 0x40 && seq[len-1] <= 0x7E) break;
             if (seq[0] == 'O' && len == 2) break;
@@ -852,10 +6480,12 @@ static void print_help(const char *prog) {
     printf("Interactive Mandelbrot/Julia fractal viewer\n\n");
     
     printf("OPTIONS:\n");
-    printf("  -t N            Worker threads (default: auto-detect)\n");
+    printf("  -t N            Worker threads (default: CPUs allowed by affinity and cgroup quota)\n");
     printf("  -nc             Disable color output\n");
     printf("  -x MIN MAX      X-axis range (default: -2.0 1.0)\n");
     printf("  -y MIN MAX      Y-axis range (default: -1.0 1.0)\n");
+    printf("  --center RE IM  View center, any number of digits (deep zoom)\n");
+    printf("  --size W H      View width and height around --center\n");
     printf("  -i N            Max iterations (default: 30, max %d)\n", MAX_ITERATIONS);
     printf("  -pal N          ASCII palette 1-%d (default: 2)\n", (int)BUILTIN_PALETTE_COUNT);
     printf("  -col N          Color scheme 1-%d (default: 1)\n", (int)COLOR_SCHEME_COUNT);
@@ -863,7 +6493,52 @@ static void print_help(const char *prog) {
     printf("  -j CR CI        Julia mode with constant c = CR + CI*i\n");
     printf("  -hb             Enable half-block mode (2x vertical resolution)\n");
     printf("  --symbols \"S\"   Custom ASCII palette (2-%d chars)\n", MAX_CUSTOM_PAL);
+    printf("  --kernel K      Escape-time kernel: auto (default), avx512, avx2,\n");
+    printf("                  neon or scalar\n");
+    printf("  --precision P   Arithmetic of views without perturbation: auto (default),\n");
+    printf("                  float, double or long (long double)\n");
+    printf("  --progressive   Draw a 1/8 resolution preview first, then refine\n");
+    printf("  --frame-budget MS\n");
+    printf("                  Draw a coarser preview first whenever a frame is\n");
+    printf("                  predicted to take longer than MS milliseconds\n");
+    printf("  -ms             Mariani-Silver solid guessing: flood-fill rectangles\n");
+    printf("                  whose border has one iteration count\n");
+    printf("  --no-interior   Disable cardioid/bulb test and periodicity detection\n");
+    printf("                  (slower, for verifying interior shortcuts)\n");
+    printf("  --keep-orbits   Keep the orbits of unescaped pixels so that raising the\n");
+    printf("                  iteration depth resumes them instead of starting over\n");
+    printf("  --cache-mb N    Tile cache for revisited views, in MiB (default: 64,\n");
+    printf("                  0 = off)\n");
+    printf("  -sched S        Work distribution: static (row bands), dynamic\n");
+    printf("                  (shared tile counter, default) or steal\n");
+    printf("  --affinity A    Pin worker threads to CPUs: none (default), compact\n");
+    printf("                  (in CPU order) or spread (round-robin over NUMA nodes)\n");
     printf("  -b, --batch     Render once and exit\n");
+    printf("  -W N, -H N      Batch render N columns wide / N rows high, regardless\n");
+    printf("                  of the terminal; streamed in bands (max %d)\n", MAX_POSTER_SIZE);
+    printf("  -o FILE         Write the batch render to FILE; a .ppm or .png name writes\n");
+    printf("                  an image with one pixel per point, .raw a raw export\n");
+    printf("  --true-color    Colour .ppm/.png images along a gradient over the whole\n");
+    printf("                  depth instead of in 16 repeating colours\n");
+    printf("  --frames N      Zoom animation: N frames from the start view to the\n");
+    printf("                  --zoom-to view; -o takes a pattern like frame%%04d.ppm\n");
+    printf("                  (default: every frame to stdout)\n");
+    printf("  --zoom-to RE IM W\n");
+    printf("                  Animation target: center RE + IM*i, view width W\n");
+    printf("  --bench         Time a fixed set of views headless (%dx%d cells unless\n", BENCH_W, BENCH_H);
+    printf("                  -W/-H are given) and print throughput per view\n");
+    printf("  --bench-out F   Also write the benchmark report to F (.csv or .json)\n");
+    printf("  --backend B     Compute on cpu (default) or gpu (OpenCL, double precision;\n");
+    printf("                  deep zoom, -ms and progressive passes stay on the CPU)\n");
+    printf("  --serve PORT    Run as a tile server for --coordinator on TCP PORT\n");
+    printf("  --coordinator HOST:PORT[,HOST:PORT...]\n");
+    printf("                  Compute frames on these --serve hosts instead of here\n");
+    printf("                  (%d tiles in flight each; a host silent for %ds is\n", REMOTE_WINDOW, REMOTE_TIMEOUT_MS / 1000);
+    printf("                  dropped and its tiles reassigned)\n");
+    printf("  --daemon SRC    Render one request per line read from stdin (SRC -) or\n");
+    printf("                  the Unix socket SRC; replies are framed OK <bytes> / ERR\n");
+    printf("  --load FILE     Present a raw export (r key, -o .raw) without recomputing\n");
+    printf("                  it; palette, colours and mapping can still be changed\n");
     printf("  -h, --help      Show this help\n\n");
     
     printf("CONTROLS (NumLock OFF for numpad):\n");
@@ -880,14 +6555,431 @@ static void print_help(const char *prog) {
     printf("  m                    Toggle modulo/linear mode\n");
     printf("  j                    Toggle Julia/Mandelbrot mode\n");
     printf("  h                    Toggle half-block rendering\n");
+    printf("  s                    Toggle frame cost in the header (compute/draw\n");
+    printf("                       time, bytes, iterations, load balance)\n");
     printf("  p                    Save to .txt (plain ASCII)\n");
-    printf("  P (Shift+p)          Save to .ansi (with colors)\n");
+    printf("  P (Shift+p)          Save to .ansi (as shown, with colors)\n");
+    printf("  r                    Save to .raw (iteration counts, for --load)\n");
+    printf("  i                    Save to .png (one pixel per point)\n");
     printf("  q                    Quit\n\n");
     
     printf("The header shows a command to recreate the current view.\n");
     printf("In Julia mode, the constant c is taken from the Mandelbrot center.\n");
 }
 
+/* ========================================================================== */
+/*                           RENDER OPTIONS                                   */
+/* ========================================================================== */
+
+/*
+ * Options that describe one render - view, depth, palette, output - as
+ * opposed to how the process runs. main() takes them from the command
+ * line, the daemon from every request line, so both accept exactly what
+ * build_cmdline() prints.
+ */
+typedef struct {
+    int center_given;             /* --center: the view is relative to it */
+    double size_w, size_h;        /* --size, 0 = keep the -x/-y extent */
+} ViewOptions;
+
+static char option_error[160];
+
+static int option_fail(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(option_error, sizeof(option_error), fmt, ap);
+    va_end(ap);
+    return -1;
+}
+
+/*
+ * Take the render option at argv[*at] and its arguments. Returns 1 and
+ * advances *at past them, 0 if it is not a render option, or -1 with the
+ * reason in option_error.
+ */
+static int render_option(int argc, char **argv, int *at, ViewOptions *opts) {
+    int i = *at;
+    if (!strcmp(argv[i], "-nc")) {
+        use_color = 0;
+    }
+    else if (!strcmp(argv[i], "-hb")) {
+        use_halfblock = 1;
+    }
+    else if (!strcmp(argv[i], "-ms")) {
+        solid_guess = 1;
+    }
+    else if (!strcmp(argv[i], "--no-interior")) {
+        interior_check = 0;
+    }
+    else if (!strcmp(argv[i], "--true-color")) {
+        true_color = 1;
+    }
+    else if ((!strcmp(argv[i], "-W") || !strcmp(argv[i], "-H")) && i + 1 < argc) {
+        int *size = argv[i][1] == 'W' ? &poster_w : &poster_h;
+        *size = atoi(argv[++i]);
+        if (*size < 1 || *size > MAX_POSTER_SIZE)
+            return option_fail("output size must be 1-%d", MAX_POSTER_SIZE);
+        batch_mode = 1;
+    }
+    else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+        output_path = argv[++i];
+        batch_mode = 1;
+    }
+    else if (!strcmp(argv[i], "-x") && i + 2 < argc) {
+        view_xmin = atof(argv[++i]);
+        view_xmax = atof(argv[++i]);
+        if (view_xmin >= view_xmax)
+            return option_fail("xmin must be less than xmax");
+    }
+    else if (!strcmp(argv[i], "-y") && i + 2 < argc) {
+        view_ymin = atof(argv[++i]);
+        view_ymax = atof(argv[++i]);
+        if (view_ymin >= view_ymax)
+            return option_fail("ymin must be less than ymax");
+    }
+    else if (!strcmp(argv[i], "--center") && i + 2 < argc) {
+        if (big_parse(&view_origin_re, argv[i + 1]) != 0 ||
+            big_parse(&view_origin_im, argv[i + 2]) != 0)
+            return option_fail("invalid --center coordinates");
+        i += 2;
+        opts->center_given = 1;
+    }
+    else if (!strcmp(argv[i], "--size") && i + 2 < argc) {
+        opts->size_w = atof(argv[++i]);
+        opts->size_h = atof(argv[++i]);
+        if (!(opts->size_w > 0) || !(opts->size_h > 0))
+            return option_fail("view size must be positive");
+    }
+    else if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+        max_iter = atoi(argv[++i]);
+        if (max_iter < 1 || max_iter > MAX_ITERATIONS)
+            return option_fail("iterations must be 1-%d", MAX_ITERATIONS);
+    }
+    else if (!strcmp(argv[i], "-pal") && i + 1 < argc) {
+        int v = atoi(argv[++i]) - 1;
+        if (v < 0 || v >= (int)BUILTIN_PALETTE_COUNT)
+            return option_fail("palette must be 1-%d", (int)BUILTIN_PALETTE_COUNT);
+        current_palette = v;
+    }
+    else if (!strcmp(argv[i], "-col") && i + 1 < argc) {
+        int v = atoi(argv[++i]) - 1;
+        if (v < 0 || v >= (int)COLOR_SCHEME_COUNT)
+            return option_fail("color must be 1-%d", (int)COLOR_SCHEME_COUNT);
+        current_color_scheme = v;
+    }
+    else if ((!strcmp(argv[i], "-m") || !strcmp(argv[i], "--mode")) && i + 1 < argc) {
+        i++;
+        if (!strcmp(argv[i], "mod") || !strcmp(argv[i], "modulo")) {
+            use_modulo = 1;
+        } else if (!strcmp(argv[i], "lin") || !strcmp(argv[i], "linear")) {
+            use_modulo = 0;
+        } else 
+            return option_fail("mode must be 'mod' or 'lin'");
+    }
+    else if (!strcmp(argv[i], "-j") && i + 2 < argc) {
+        julia_mode = 1;
+        julia_cr = atof(argv[++i]);
+        julia_ci = atof(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--symbols") && i + 1 < argc) {
+        const char *s = argv[++i];
+        size_t len = strlen(s);
+        if (len < 2 || len > MAX_CUSTOM_PAL)
+            return option_fail("--symbols requires 2-%d characters", MAX_CUSTOM_PAL);
+        strncpy(custom_palette, s, MAX_CUSTOM_PAL);
+        custom_palette[MAX_CUSTOM_PAL] = '\0';
+        has_custom_palette = 1;
+    }
+    else if (!strcmp(argv[i], "--precision") && i + 1 < argc) {
+        i++;
+        int v = strcmp(argv[i], "auto") ? -2 : PREC_AUTO;
+        for (int k = 0; k < (int)(sizeof(precision_names) / sizeof(precision_names[0])); k++)
+            if (!strcmp(argv[i], precision_names[k])) v = k;
+        if (v < PREC_AUTO)
+            return option_fail("precision must be 'auto', 'float', 'double' or 'long'");
+        precision_mode = (Precision)v;
+    }
+    else return 0;
+    *at = i;
+    return 1;
+}
+
+/* Finish the view and palette once all render options are in */
+static void apply_view_options(const ViewOptions *opts) {
+    /* With --center the viewport is relative to the (fixed-point) center */
+    if (opts->center_given) {
+        double hw = (opts->size_w > 0 ? opts->size_w : view_xmax - view_xmin) / 2;
+        double hh = (opts->size_h > 0 ? opts->size_h : view_ymax - view_ymin) / 2;
+        view_xmin = -hw; view_xmax = hw;
+        view_ymin = -hh; view_ymax = hh;
+    } else if (opts->size_w > 0) {
+        double cx = (view_xmin + view_xmax) / 2, cy = (view_ymin + view_ymax) / 2;
+        view_xmin = cx - opts->size_w / 2; view_xmax = cx + opts->size_w / 2;
+        view_ymin = cy - opts->size_h / 2; view_ymax = cy + opts->size_h / 2;
+    }
+    
+    if (has_custom_palette) {
+        palettes[BUILTIN_PALETTE_COUNT] = custom_palette;
+        current_palette = BUILTIN_PALETTE_COUNT;
+        palette_count = BUILTIN_PALETTE_COUNT + 1;
+        lut_key.palette = -1;        /* Same index, perhaps other symbols (daemon) */
+    }
+}
+
+/* ========================================================================== */
+/*                               DAEMON                                       */
+/* ========================================================================== */
+
+/*
+ * Render daemon (--daemon SRC). Each line read from stdin (SRC "-") or
+ * from a client of the Unix socket SRC is a render: the render options of
+ * the command line, as build_cmdline() prints them - a leading "marcepan"
+ * and anything after an unquoted | are ignored, quoting works as in a
+ * shell. Every request starts from the settings the daemon was started
+ * with. The reply is one line, then the payload:
+ *
+ *   OK <bytes>\n<bytes of output>     ERR <reason>\n
+ *
+ * The payload is what batch mode would print, or with -o the format the
+ * name's suffix selects (.ppm, .png, .raw, else text). The daemon never
+ * writes files: a client can only get bytes back. The socket is created
+ * for the daemon's user alone. The pool, the tile cache, the last frame
+ * (for pans and depth changes) and the reply buffer stay allocated from
+ * one request to the next. Clients are served one at a time.
+ */
+#define DAEMON_MAX_WORDS   64
+#define DAEMON_FRAME_CELLS (1 << 22)  /* Larger renders are computed in bands */
+
+/* Everything a request's render options can change */
+typedef struct {
+    double xmin, xmax, ymin, ymax;
+    BigFix origin_re, origin_im;
+    int max_iter;
+    int palette, palette_count, color_scheme;
+    int color, modulo, halfblock;
+    int interior_check, solid_guess, true_color;
+    int julia_mode;
+    double julia_cr, julia_ci;
+    Precision precision;
+    int has_custom_palette;
+    char custom_palette[MAX_CUSTOM_PAL + 1];
+    int poster_w, poster_h;
+    const char *output_path;
+} RenderSettings;
+
+static void settings_save(RenderSettings *s) {
+    s->xmin = view_xmin; s->xmax = view_xmax;
+    s->ymin = view_ymin; s->ymax = view_ymax;
+    s->origin_re = view_origin_re; s->origin_im = view_origin_im;
+    s->max_iter = max_iter;
+    s->palette = current_palette;
+    s->palette_count = palette_count;
+    s->color_scheme = current_color_scheme;
+    s->color = use_color; s->modulo = use_modulo; s->halfblock = use_halfblock;
+    s->interior_check = interior_check; s->solid_guess = solid_guess;
+    s->true_color = true_color;
+    s->julia_mode = julia_mode; s->julia_cr = julia_cr; s->julia_ci = julia_ci;
+    s->precision = precision_mode;
+    s->has_custom_palette = has_custom_palette;
+    memcpy(s->custom_palette, custom_palette, sizeof(custom_palette));
+    s->poster_w = poster_w; s->poster_h = poster_h;
+    s->output_path = output_path;
+}
+
+static void settings_restore(const RenderSettings *s) {
+    view_xmin = s->xmin; view_xmax = s->xmax;
+    view_ymin = s->ymin; view_ymax = s->ymax;
+    view_origin_re = s->origin_re; view_origin_im = s->origin_im;
+    max_iter = s->max_iter;
+    current_palette = s->palette;
+    palette_count = s->palette_count;
+    current_color_scheme = s->color_scheme;
+    use_color = s->color; use_modulo = s->modulo; use_halfblock = s->halfblock;
+    interior_check = s->interior_check; solid_guess = s->solid_guess;
+    true_color = s->true_color;
+    julia_mode = s->julia_mode; julia_cr = s->julia_cr; julia_ci = s->julia_ci;
+    precision_mode = s->precision;
+    has_custom_palette = s->has_custom_palette;
+    memcpy(custom_palette, s->custom_palette, sizeof(custom_palette));
+    poster_w = s->poster_w; poster_h = s->poster_h;
+    output_path = s->output_path;
+}
+
+/*
+ * Split line in place into at most max words: blanks separate them, ''
+ * and "" quote, a backslash escapes the next character (except inside
+ * ''), and an unquoted | word ends the command. Returns the word count,
+ * or -1 for too many words or an open quote.
+ */
+static int split_words(char *line, char **words, int max) {
+    char *src = line, *dst = line;
+    int n = 0;
+    for (;;) {
+        while (*src && strchr(" \t\r\n", *src)) src++;
+        if (!*src || *src == '|') return n;
+        if (n == max) return -1;
+        words[n++] = dst;
+        
+        char quote = 0;
+        while (*src && (quote || !strchr(" \t\r\n", *src))) {
+            char c = *src++;
+            if (c == quote) {
+                quote = 0;
+            } else if (!quote && (c == '\'' || c == '"')) {
+                quote = c;
+            } else if (c == '\\' && quote != '\'' && *src) {
+                *dst++ = *src++;
+            } else {
+                *dst++ = c;
+            }
+        }
+        if (quote) return -1;
+        if (*src) src++;
+        *dst++ = '\0';
+    }
+}
+
+/*
+ * Render one request line into reply (payload only). Returns 0, 1 for a
+ * blank line (no reply), or -1 with the reason in option_error. *frame is
+ * the previous request's frame and is replaced by this one's if it was
+ * computed whole.
+ */
+static int daemon_request(char *line, const RenderSettings *defaults, OutSegment *reply,
+                          IterCount **frame, int *frame_w, int *frame_h) {
+    char *words[DAEMON_MAX_WORDS];
+    int n = split_words(line, words, DAEMON_MAX_WORDS);
+    if (n < 0) return option_fail("unbalanced quotes or too many words");
+    if (n == 0) return 1;
+    
+    settings_restore(defaults);
+    ViewOptions vopts = { 0, 0, 0 };
+    int i = 0;
+    if (n > 0) {
+        const char *slash = strrchr(words[0], '/');
+        if (!strcmp(slash ? slash + 1 : words[0], "marcepan")) i = 1;
+    }
+    for (; i < n; i++) {
+        int r = render_option(n, words, &i, &vopts);
+        if (r < 0) return -1;
+        if (!r) return option_fail("unknown option: %s", words[i]);
+    }
+    apply_view_options(&vopts);
+    if (image_format(output_format(output_path))) use_halfblock = 0;
+    
+    reply->len = 0;
+    writer_sink = reply;
+    
+    /* Frames that fit in memory go through setup_frame: reuse and the tile cache */
+    int w, h, status;
+    frame_size(&w, &h);
+    if ((size_t)w * h <= DAEMON_FRAME_CELLS) {
+        status = compute_fractal(frame, frame_w, frame_h);
+        if (status == 0) status = write_poster(-1, *frame, *frame_w, *frame_h);
+    } else {
+        status = write_poster(-1, NULL, 0, 0);
+    }
+    
+    writer_sink = NULL;
+    return status == 0 ? 0 : option_fail("render failed");
+}
+
+/* Answer the request lines from in until it closes or a reply cannot be sent */
+static void daemon_session(int in, int out, const RenderSettings *defaults) {
+    static OutSegment reply;
+    static IterCount *frame;
+    static int frame_w, frame_h;
+    
+    FILE *f = fdopen(in, "r");
+    if (!f) return;
+    char *line = NULL;
+    size_t cap = 0;
+    while (getline(&line, &cap, f) > 0) {
+        char head[sizeof(option_error) + 16];
+        int len;
+        struct iovec iov[2];
+        int cnt = 1;
+        int r = daemon_request(line, defaults, &reply, &frame, &frame_w, &frame_h);
+        if (r > 0) continue;
+        if (r == 0) {
+            len = snprintf(head, sizeof(head), "OK %zu\n", reply.len);
+            iov[1] = (struct iovec){ reply.buf, reply.len };
+            cnt = reply.len ? 2 : 1;
+        } else {
+            len = snprintf(head, sizeof(head), "ERR %s\n", option_error);
+        }
+        iov[0] = (struct iovec){ head, (size_t)len };
+        if (safe_writev(out, iov, cnt) != 0) break;
+    }
+    free(line);
+    fclose(f);
+}
+
+static int run_daemon(const char *src) {
+    RenderSettings defaults;
+    settings_save(&defaults);
+    
+    if (!strcmp(src, "-")) {
+        daemon_session(STDIN_FILENO, STDOUT_FILENO, &defaults);
+        return 0;
+    }
+    
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(src) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: socket path %s is too long\n", src);
+        return -1;
+    }
+    strcpy(addr.sun_path, src);
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    
+    /*
+     * A socket left behind by a daemon that has exited is replaced; one
+     * that still accepts connections belongs to a running daemon.
+     */
+    struct stat st;
+    if (stat(src, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        int live = probe >= 0 && connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+        int stale = !live && errno == ECONNREFUSED;
+        if (probe >= 0) close(probe);
+        if (live) {
+            fprintf(stderr, "Error: a daemon is already serving on %s\n", src);
+            close(fd);
+            return -1;
+        }
+        if (stale) unlink(src);
+    }
+    
+    /* Only the daemon's user may connect */
+    mode_t mask = umask(0077);
+    int err = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(mask);
+    if (err != 0 || listen(fd, 8) != 0) {
+        fprintf(stderr, "Error: cannot listen on %s: %s\n", src, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    
+    fprintf(stderr, "Serving renders on %s: %s backend, %d thread%s, %s kernel\n",
+            src, active_backend->name, pool_size(), pool_size() == 1 ? "" : "s",
+            active_kernel->name);
+    for (;;) {
+        int c = accept(fd, NULL, NULL);
+        if (c < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("accept");
+            close(fd);
+            return -1;
+        }
+        daemon_session(c, c, &defaults);
+    }
+}
+
 /* ========================================================================== */
 /*                              MAIN                                          */
 /* ========================================================================== */
@@ -899,85 +6991,113 @@ int main(int argc, char **argv) {
     palette_count = BUILTIN_PALETTE_COUNT;
     
     /* Parse arguments */
+    ViewOptions vopts = { 0, 0, 0 };
+    const char *load_path = NULL;
+    const char *bench_path = NULL;
+    int bench = 0;
+    int zoom_to_given = 0;
+    const char *serve_port = NULL;
+    const char *daemon_src = NULL;
+    const char *backend_name = NULL;
     for (int i = 1; i < argc; i++) {
+        int r = render_option(argc, argv, &i, &vopts);
+        if (r < 0) {
+            fprintf(stderr, "Error: %s\n", option_error);
+            return 1;
+        }
+        if (r) continue;
         if (!strcmp(argv[i], "-t") && i + 1 < argc) {
             num_threads = atoi(argv[++i]);
             if (num_threads < 0 || num_threads > MAX_THREADS) num_threads = 0;
         }
-        else if (!strcmp(argv[i], "-nc")) {
-            use_color = 0;
+        else if (!strcmp(argv[i], "--progressive")) {
+            progressive = 1;
         }
-        else if (!strcmp(argv[i], "-hb")) {
-            use_halfblock = 1;
+        else if (!strcmp(argv[i], "--frame-budget") && i + 1 < argc) {
+            frame_budget_ms = atoi(argv[++i]);
+            if (frame_budget_ms < 1 || frame_budget_ms > 60000) {
+                fprintf(stderr, "Error: frame budget must be 1-60000 ms\n");
+                return 1;
+            }
         }
         else if (!strcmp(argv[i], "-b") || !strcmp(argv[i], "--batch")) {
             batch_mode = 1;
         }
-        else if (!strcmp(argv[i], "-x") && i + 2 < argc) {
-            view_xmin = atof(argv[++i]);
-            view_xmax = atof(argv[++i]);
-            if (view_xmin >= view_xmax) {
-                fprintf(stderr, "Error: xmin must be less than xmax\n");
-                return 1;
-            }
+        else if (!strcmp(argv[i], "--load") && i + 1 < argc) {
+            load_path = argv[++i];
         }
-        else if (!strcmp(argv[i], "-y") && i + 2 < argc) {
-            view_ymin = atof(argv[++i]);
-            view_ymax = atof(argv[++i]);
-            if (view_ymin >= view_ymax) {
-                fprintf(stderr, "Error: ymin must be less than ymax\n");
-                return 1;
-            }
+        else if (!strcmp(argv[i], "--bench")) {
+            bench = 1;
         }
-        else if (!strcmp(argv[i], "-i") && i + 1 < argc) {
-            max_iter = atoi(argv[++i]);
-            if (max_iter < 1 || max_iter > MAX_ITERATIONS) {
-                fprintf(stderr, "Error: iterations must be 1-%d\n", MAX_ITERATIONS);
+        else if (!strcmp(argv[i], "--bench-out") && i + 1 < argc) {
+            bench_path = argv[++i];
+            bench = 1;
+        }
+        else if (!strcmp(argv[i], "--serve") && i + 1 < argc) {
+            serve_port = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--daemon") && i + 1 < argc) {
+            daemon_src = argv[++i];
+            batch_mode = 1;
+        }
+        else if (!strcmp(argv[i], "--coordinator") && i + 1 < argc) {
+            coordinator_hosts = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            anim_frames = atoi(argv[++i]);
+            if (anim_frames < 1 || anim_frames > MAX_FRAMES) {
+                fprintf(stderr, "Error: frame count must be 1-%d\n", MAX_FRAMES);
                 return 1;
             }
+            batch_mode = 1;
         }
-        else if (!strcmp(argv[i], "-pal") && i + 1 < argc) {
-            int v = atoi(argv[++i]) - 1;
-            if (v < 0 || v >= (int)BUILTIN_PALETTE_COUNT) {
-                fprintf(stderr, "Error: palette must be 1-%d\n", (int)BUILTIN_PALETTE_COUNT);
+        else if (!strcmp(argv[i], "--zoom-to") && i + 3 < argc) {
+            anim_width = atof(argv[i + 3]);
+            if (big_parse(&anim_re, argv[i + 1]) != 0 ||
+                big_parse(&anim_im, argv[i + 2]) != 0 || !(anim_width > 0)) {
+                fprintf(stderr, "Error: invalid --zoom-to target\n");
                 return 1;
             }
-            current_palette = v;
+            i += 3;
+            zoom_to_given = 1;
+        }
+        else if (!strcmp(argv[i], "--kernel") && i + 1 < argc) {
+            kernel_name = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--backend") && i + 1 < argc) {
+            backend_name = argv[++i];
         }
-        else if (!strcmp(argv[i], "-col") && i + 1 < argc) {
-            int v = atoi(argv[++i]) - 1;
-            if (v < 0 || v >= (int)COLOR_SCHEME_COUNT) {
-                fprintf(stderr, "Error: color must be 1-%d\n", (int)COLOR_SCHEME_COUNT);
+        else if (!strcmp(argv[i], "--keep-orbits")) {
+            keep_orbits = 1;
+        }
+        else if (!strcmp(argv[i], "--cache-mb") && i + 1 < argc) {
+            cache_mb = atoi(argv[++i]);
+            if (cache_mb < 0 || cache_mb > 65536) {
+                fprintf(stderr, "Error: cache size must be 0-65536 MiB\n");
                 return 1;
             }
-            current_color_scheme = v;
         }
-        else if ((!strcmp(argv[i], "-m") || !strcmp(argv[i], "--mode")) && i + 1 < argc) {
+        else if (!strcmp(argv[i], "-sched") && i + 1 < argc) {
             i++;
-            if (!strcmp(argv[i], "mod") || !strcmp(argv[i], "modulo")) {
-                use_modulo = 1;
-            } else if (!strcmp(argv[i], "lin") || !strcmp(argv[i], "linear")) {
-                use_modulo = 0;
-            } else {
-                fprintf(stderr, "Error: mode must be 'mod' or 'lin'\n");
+            int v = -1;
+            for (int k = 0; k < (int)(sizeof(sched_names) / sizeof(sched_names[0])); k++)
+                if (!strcmp(argv[i], sched_names[k])) v = k;
+            if (v < 0) {
+                fprintf(stderr, "Error: scheduler must be 'static', 'dynamic' or 'steal'\n");
                 return 1;
             }
+            sched_mode = (SchedMode)v;
         }
-        else if (!strcmp(argv[i], "-j") && i + 2 < argc) {
-            julia_mode = 1;
-            julia_cr = atof(argv[++i]);
-            julia_ci = atof(argv[++i]);
-        }
-        else if (!strcmp(argv[i], "--symbols") && i + 1 < argc) {
-            const char *s = argv[++i];
-            size_t len = strlen(s);
-            if (len < 2 || len > MAX_CUSTOM_PAL) {
-                fprintf(stderr, "Error: --symbols requires 2-%d characters\n", MAX_CUSTOM_PAL);
+        else if (!strcmp(argv[i], "--affinity") && i + 1 < argc) {
+            i++;
+            int v = -1;
+            for (int k = 0; k < (int)(sizeof(affinity_names) / sizeof(affinity_names[0])); k++)
+                if (!strcmp(argv[i], affinity_names[k])) v = k;
+            if (v < 0) {
+                fprintf(stderr, "Error: affinity must be 'none', 'compact' or 'spread'\n");
                 return 1;
             }
-            strncpy(custom_palette, s, MAX_CUSTOM_PAL);
-            custom_palette[MAX_CUSTOM_PAL] = '\0';
-            has_custom_palette = 1;
+            affinity_mode = (AffinityMode)v;
         }
         else if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
             print_help(argv[0]);
@@ -990,14 +7110,93 @@ int main(int argc, char **argv) {
         }
     }
     
-    if (has_custom_palette) {
-        palettes[palette_count] = custom_palette;
-        current_palette = palette_count++;
+    apply_view_options(&vopts);
+    
+    if (anim_frames || zoom_to_given) {
+        if (!anim_frames || !zoom_to_given || load_path) {
+            fprintf(stderr, "Error: an animation needs --frames and --zoom-to, and no --load\n");
+            return 1;
+        }
+        if (output_path && !frame_pattern_ok(output_path)) {
+            fprintf(stderr, "Error: -o needs a frame number such as frame%%04d.ppm\n");
+            return 1;
+        }
+    }
+    
+    if (serve_port && (coordinator_hosts || bench || anim_frames || load_path)) {
+        fprintf(stderr, "Error: --serve only serves tiles; give render options to the coordinator\n");
+        return 1;
+    }
+    
+    if (daemon_src && (serve_port || bench || anim_frames || load_path)) {
+        fprintf(stderr, "Error: --daemon takes render options with each request\n");
+        return 1;
+    }
+    
+    if (coordinator_hosts && backend_name) {
+        fprintf(stderr, "Error: with --coordinator the servers choose their --backend\n");
+        return 1;
     }
     
-    if (num_threads == 0) {
-        num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
-        if (num_threads < 1) num_threads = 4;
+    if (load_path) {
+        if (poster_w || poster_h) {
+            fprintf(stderr, "Error: a loaded frame keeps its size, -W/-H do not apply\n");
+            return 1;
+        }
+        if (load_raw(load_path) != 0) return 1;
+    }
+    
+    /* An image has one pixel per point: half-block mode would only stretch it */
+    if (image_format(output_format(output_path)) && !loaded_data) use_halfblock = 0;
+    
+    if (select_kernel(kernel_name) != 0) {
+        fprintf(stderr, "Error: kernel '%s' is unknown or not supported by this CPU\n",
+                kernel_name);
+        return 1;
+    }
+    
+    if (num_threads == 0) num_threads = default_thread_count();
+    update_term_size();
+    
+    init_sgr_tables();
+    if (bench || serve_port) {
+        batch_mode = 1;
+        cache_mb = 0;
+    }
+    cache_init();
+    pool_start(num_threads);
+    
+    IterCount *iterations = NULL, *pending = NULL;
+    int img_w = 0, img_h = 0;
+    int status = 0;
+    
+    /* A host that went away must not take the whole process with it */
+    if (serve_port || daemon_src || coordinator_hosts) signal(SIGPIPE, SIG_IGN);
+    if (select_backend(coordinator_hosts ? "remote" : backend_name ? backend_name : "cpu") != 0) {
+        status = 1;
+        goto cleanup;
+    }
+    
+    /* Tile server, daemon, benchmark, animation and offline renders: the terminal is not touched */
+    if (serve_port) {
+        if (run_server(serve_port) != 0) status = 1;
+        goto cleanup;
+    }
+    if (daemon_src) {
+        if (run_daemon(daemon_src) != 0) status = 1;
+        goto cleanup;
+    }
+    if (bench) {
+        if (run_bench(bench_path) != 0) status = 1;
+        goto cleanup;
+    }
+    if (anim_frames) {
+        if (render_animation() != 0) status = 1;
+        goto cleanup;
+    }
+    if (poster_w || poster_h || output_path) {
+        if (render_poster() != 0) status = 1;
+        goto cleanup;
     }
     
     /* Setup terminal */
@@ -1009,91 +7208,217 @@ int main(int argc, char **argv) {
     enable_raw_mode();
     cursor_hide();
     
-    /* Initial render */
-    int *iterations = NULL;
-    int img_w = 0, img_h = 0;
+    /* Batch mode: one synchronous frame */    
+    if (batch_mode) {
+        if (loaded_data) {
+            render_frame(loaded_data, loaded_w, loaded_h);
+        } else if (compute_fractal(&iterations, &img_w, &img_h) == 0) {
+            render_frame(iterations, img_w, img_h);
+        }
+        goto cleanup;
+    }
     
-    if (compute_fractal(&iterations, &img_w, &img_h) == 0)
-        render_frame(iterations, img_w, img_h);
+    /*
+     * Interactive mode: frames are computed by the pool while this thread
+     * keeps reading keys. iterations is the frame on screen, pending the
+     * one being computed. A view change during a computation cancels it;
+     * the newest view is started once the cancelled job has drained, so
+     * only up-to-date frames are ever presented.
+     */
+    int notify_pipe[2];
+    if (pipe(notify_pipe) != 0 || pipe(winch_pipe) != 0 || pipe(export_pipe) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    pool_notify_fd = notify_pipe[1];
+    for (int i = 0; i < 2; i++) {
+        fcntl(winch_pipe[i], F_SETFL, O_NONBLOCK);
+        fcntl(export_pipe[i], F_SETFL, O_NONBLOCK);
+    }
+    struct sigaction sa = { .sa_handler = on_winch, .sa_flags = SA_RESTART };
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGWINCH, &sa, NULL);
     
-    /* Main loop */
-    int need_recalc = 0;
+    int pend_w = 0, pend_h = 0;
+    int pending_refine = 0;       /* pending is a refinement of iterations */
+    int restart = 0;              /* Start a new frame when pending drains */
+    int need_recalc = 1;
     int need_redraw = 0;
+    int deferred_saves = 0;       /* SAVE_* bits waiting for the new view's frame */
     
-    while (!batch_mode) {
-        int key = read_key();
-        if (key == KEY_NONE) continue;
-        
-        /* Clear status message on any key (will be replaced by cmdline) */
-        status_message[0] = '\0';
-        
-        switch (key) {
-            case 'q': goto cleanup;
-            
-            /* Panning */
-            case KEY_UP:    pan_view(0, PAN_FRACTION); need_recalc = 1; break;
-            case KEY_DOWN:  pan_view(0, -PAN_FRACTION); need_recalc = 1; break;
-            case KEY_LEFT:  pan_view(-PAN_FRACTION, 0); need_recalc = 1; break;
-            case KEY_RIGHT: pan_view(PAN_FRACTION, 0); need_recalc = 1; break;
-            
-            /* Diagonal */
-            case KEY_HOME:  pan_view(-PAN_FRACTION, PAN_FRACTION); need_recalc = 1; break;
-            case KEY_PGUP:  pan_view(PAN_FRACTION, PAN_FRACTION); need_recalc = 1; break;
-            case KEY_END:   pan_view(-PAN_FRACTION, -PAN_FRACTION); need_recalc = 1; break;
-            case KEY_PGDN:  pan_view(PAN_FRACTION, -PAN_FRACTION); need_recalc = 1; break;
-            
-            /* Zoom */
-            case KEY_INS:   zoom_view(1 - ZOOM_FRACTION); need_recalc = 1; break;
-            case KEY_ENTER: zoom_view(1 + ZOOM_FRACTION); need_recalc = 1; break;
-            
-            /* Axis zoom */
-            case KEY_SHIFT_UP:    zoom_y_axis(1 - ZOOM_FRACTION); need_recalc = 1; break;
-            case KEY_SHIFT_DOWN:  zoom_y_axis(1 + ZOOM_FRACTION); need_recalc = 1; break;
-            case KEY_SHIFT_LEFT:  zoom_x_axis(1 - ZOOM_FRACTION); need_recalc = 1; break;
-            case KEY_SHIFT_RIGHT: zoom_x_axis(1 + ZOOM_FRACTION); need_recalc = 1; break;
-            
-            /* Iterations */
-            case KEY_PLUS:
-                if (max_iter < MAX_ITERATIONS - 5) { max_iter += 5; need_recalc = 1; }
-                break;
-            case KEY_MINUS:
-                if (max_iter > 5) { max_iter -= 5; need_recalc = 1; }
-                break;
-            
-            /* Reset */
-            case KEY_ESC: reset_view(); need_recalc = 1; break;
-            
-            /* Palettes */
-            case KEY_SLASH: cycle_value(&current_palette, palette_count, -1); need_redraw = 1; break;
-            case KEY_STAR:  cycle_value(&current_palette, palette_count, 1); need_redraw = 1; break;
-            case '1': cycle_value(&current_color_scheme, COLOR_SCHEME_COUNT, -1); need_redraw = 1; break;
-            case '2': cycle_value(&current_color_scheme, COLOR_SCHEME_COUNT, 1); need_redraw = 1; break;
-            
-            /* Toggles */
-            case 'c': use_color = !use_color; need_redraw = 1; break;
-            case 'm': use_modulo = !use_modulo; need_redraw = 1; break;
-            case 'j': toggle_julia(); need_recalc = 1; break;
-            case 'h': use_halfblock = !use_halfblock; need_recalc = 1; break;
-            
-            /* Save */
-            case 'p': save_to_file(iterations, img_w, img_h); need_redraw = 1; break;
-            case 'P': save_to_file_colored(iterations, img_w, img_h); need_redraw = 1; break;
+    /*
+     * A loaded frame that fits the terminal is shown as it is. It becomes
+     * the frame on screen, so pans and depth changes reuse its pixels
+     * (deep frames excepted: they were computed against another reference).
+     */
+    if (loaded_data) {
+        update_term_size();
+        if (loaded_w == term_w && loaded_h == (use_halfblock ? term_h * 2 : term_h)) {
+            iterations = (IterCount *)loaded_data;
+            img_w = loaded_w;
+            img_h = loaded_h;
+            if (!view_deep) view_task(&last_task, img_w, img_h, 0, iterations);
+            need_recalc = 0;
+            need_redraw = 1;
         }
-        
+    }
+    
+    for (;;) {
         if (need_recalc) {
-            free(iterations);
-            iterations = NULL;
-            if (compute_fractal(&iterations, &img_w, &img_h) == 0)
-                render_frame(iterations, img_w, img_h);
+            if (pending) {
+                cancel_frame();
+                restart = 1;
+            } else {
+                pending = start_frame(iterations, &pend_w, &pend_h);
+                pending_refine = 0;
+                if (resize_preview) {
+                    render_frame(resize_preview, pend_w, pend_h);
+                    iter_buffer_put(resize_preview);
+                    resize_preview = NULL;
+                }
+            }
             need_recalc = 0;
         } else if (need_redraw) {
-            if (iterations) render_frame(iterations, img_w, img_h);
+            if (iterations && (!pending || pending_refine))
+                render_frame(iterations, img_w, img_h);
             need_redraw = 0;
         }
+        
+        int events = wait_for_event(notify_pipe[0]);
+        
+        if (events & EVENT_FRAME) {
+            int presented = finish_frame();
+            if (presented) {
+                iter_buffer_put(iterations);
+                iterations = pending;
+                img_w = pend_w;
+                img_h = pend_h;
+                render_frame(iterations, img_w, img_h);
+            } else {
+                iter_buffer_put(pending);
+            }
+            pending = NULL;
+            
+            if (restart) {
+                restart = 0;
+                need_recalc = 1;
+            } else {
+                if (presented && deferred_saves) {
+                    save_frame(deferred_saves, iterations, img_w, img_h);
+                    deferred_saves = 0;
+                    need_redraw = 1;
+                }
+                if (refine_stride > 1) {
+                    pending = start_refine(iterations);
+                    pending_refine = 1;
+                }
+            }
+        }
+        
+        if (events & EVENT_RESIZE) {
+            resize_view();
+            screen_invalidate();          /* The terminal may have reflowed it */
+            need_recalc = 1;
+        }
+        
+        if ((events & EVENT_EXPORT) && export_poll()) need_redraw = 1;
+        
+        if (!(events & EVENT_KEY)) continue;
+        
+        /* Clear status message on any key (will be replaced by cmdline) */
+        status_message[0] = '\0';
+        
+        /*
+         * Apply every key that has arrived before acting on any of them:
+         * a burst of pans, zooms and depth steps lands as one view change
+         * and starts one frame, instead of one (cancelled) frame per key.
+         */
+        do {
+            int key = read_key();
+            switch (key) {
+                case 'q': goto cleanup;
+                
+                /* Panning */
+                case KEY_UP:    pan_view(0, PAN_FRACTION); need_recalc = 1; break;
+                case KEY_DOWN:  pan_view(0, -PAN_FRACTION); need_recalc = 1; break;
+                case KEY_LEFT:  pan_view(-PAN_FRACTION, 0); need_recalc = 1; break;
+                case KEY_RIGHT: pan_view(PAN_FRACTION, 0); need_recalc = 1; break;
+                
+                /* Diagonal */
+                case KEY_HOME:  pan_view(-PAN_FRACTION, PAN_FRACTION); need_recalc = 1; break;
+                case KEY_PGUP:  pan_view(PAN_FRACTION, PAN_FRACTION); need_recalc = 1; break;
+                case KEY_END:   pan_view(-PAN_FRACTION, -PAN_FRACTION); need_recalc = 1; break;
+                case KEY_PGDN:  pan_view(PAN_FRACTION, -PAN_FRACTION); need_recalc = 1; break;
+                
+                /* Zoom */
+                case KEY_INS:   zoom_view(1 - ZOOM_FRACTION); need_recalc = 1; break;
+                case KEY_ENTER: zoom_view(1 / (1 - ZOOM_FRACTION)); need_recalc = 1; break;
+                
+                /* Axis zoom */
+                case KEY_SHIFT_UP:    zoom_y_axis(1 - ZOOM_FRACTION); need_recalc = 1; break;
+                case KEY_SHIFT_DOWN:  zoom_y_axis(1 / (1 - ZOOM_FRACTION)); need_recalc = 1; break;
+                case KEY_SHIFT_LEFT:  zoom_x_axis(1 - ZOOM_FRACTION); need_recalc = 1; break;
+                case KEY_SHIFT_RIGHT: zoom_x_axis(1 / (1 - ZOOM_FRACTION)); need_recalc = 1; break;
+                
+                /* Iterations */
+                case KEY_PLUS:
+                    if (max_iter < MAX_ITERATIONS - 5) { max_iter += 5; need_recalc = 1; }
+                    break;
+                case KEY_MINUS:
+                    if (max_iter > 5) { max_iter -= 5; need_recalc = 1; }
+                    break;
+                
+                /* Reset */
+                case KEY_ESC: reset_view(); need_recalc = 1; break;
+                
+                /* Palettes */
+                case KEY_SLASH: cycle_value(&current_palette, palette_count, -1); need_redraw = 1; break;
+                case KEY_STAR:  cycle_value(&current_palette, palette_count, 1); need_redraw = 1; break;
+                case '1': cycle_value(&current_color_scheme, COLOR_SCHEME_COUNT, -1); need_redraw = 1; break;
+                case '2': cycle_value(&current_color_scheme, COLOR_SCHEME_COUNT, 1); need_redraw = 1; break;
+                
+                /* Toggles */
+                case 'c': use_color = !use_color; need_redraw = 1; break;
+                case 'm': use_modulo = !use_modulo; need_redraw = 1; break;
+                case 'j': toggle_julia(); need_recalc = 1; break;
+                case 'h': use_halfblock = !use_halfblock; need_recalc = 1; break;
+                case 's': show_stats = !show_stats; need_redraw = 1; break;
+                
+                /* Save */
+                case 'p': case 'P': case 'r': case 'i': {
+                    int save = key == 'p' ? SAVE_TXT : key == 'P' ? SAVE_ANSI :
+                               key == 'r' ? SAVE_RAW : SAVE_PNG;
+                    if (need_recalc || (pending && !pending_refine)) {
+                        deferred_saves |= save;
+                    } else {
+                        save_frame(save, iterations, img_w, img_h);
+                    }
+                    need_redraw = 1;
+                    break;
+                }
+            }
+        } while (input_pending());
     }
     
 cleanup:
-    free(iterations);
+    if (pending) {
+        cancel_frame();
+        pool_wait();
+    }
+    export_free();
+    pool_stop();
+    active_backend->close();
+    iter_buffers_free();
+    cache_free();
+    free(orbit_buffers[0].data);
+    free(orbit_buffers[1].data);
+    free(deep_orbit.zr);
+    free(deep_orbit.zi);
+    if (loaded_map) munmap(loaded_map, loaded_map_size);
+    screen_invalidate();
+    free(frame_cells);
+    free(cell_lut);
+    for (int i = 0; i < MAX_THREADS; i++) free(out_segs[i].buf);
     if (!batch_mode) screen_clear();
-    return 0;
+    return status;
 }
\ No newline at end of file